@@ -17,6 +17,13 @@ extern "C" {
         AssocEntry **buckets;  /* array of bucket heads */
         size_t       nbuckets; /* buckets length (power of two) */
         size_t       nentries; /* number of live entries with nonzero val */
+
+        /* Blocked Bloom filter over keys, consulted by assoc_get before the
+         * chain walk. Rebuilt on resize and once enough deletes went stale. */
+        unsigned long long *bloom;         /* bloom_blocks * 8 words; NULL = disabled */
+        size_t              bloom_blocks;  /* 512-bit blocks */
+        size_t              bloom_stale;   /* deletes since the last rebuild */
+        int                 use_bloom;     /* 0 = skip the filter (benchmarking) */
     } Assoc;
 
     /* Initialize/teardown */
@@ -29,15 +36,30 @@ extern "C" {
     /* Get current value for a key (0 if absent). */
     int  assoc_get(const Assoc *a, int i, int pi, int k, int pk);
 
+    /* 0 if the key is certainly absent, 1 if it may be present (filter only). */
+    int  assoc_maybe_contains(const Assoc *a, int i, int pi, int k, int pk);
+
+    /* Bytes held by the Bloom filter. */
+    size_t assoc_bloom_bytes(const Assoc *a);
+
     /* Iterator: walk all entries (order undefined). */
     typedef struct {
         const Assoc *a;
         size_t bucket;
+        size_t end;        /* one past the last bucket to visit */
         AssocEntry *e;
     } AssocIter;
 
     static inline void assoc_iter_init(const Assoc *a, AssocIter *it) {
-        it->a = a; it->bucket = 0; it->e = NULL;
+        it->a = a; it->bucket = 0; it->end = a ? a->nbuckets : 0; it->e = NULL;
+    }
+
+    /* Walk only buckets [lo, hi), so disjoint ranges can be read in parallel. */
+    static inline void assoc_iter_range(const Assoc *a, AssocIter *it, size_t lo, size_t hi) {
+        size_t n = a ? a->nbuckets : 0;
+        it->a = a; it->e = NULL;
+        it->end = hi < n ? hi : n;
+        it->bucket = lo < it->end ? lo : it->end;
     }
     int assoc_iter_next(AssocIter *it, int *i, int *pi, int *k, int *pk, int *val);
 
@@ -0,0 +1,24 @@
+#ifndef AMOEBA_BENCH_H
+#define AMOEBA_BENCH_H
+
+/*
+ * bench.h — built-in micro-benchmarks (amoeba --bench)
+ *
+ * Runs against synthetic data only: no commands are spawned and the
+ * database is not touched. Results are printed to `fp`.
+ */
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+    #endif
+
+    /* Run every benchmark; returns 0 on success, non-zero if one failed. */
+    int run_benchmarks(FILE *fp);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif /* AMOEBA_BENCH_H */
@@ -0,0 +1,58 @@
+#ifndef AMOEBA_BUFPOOL_H
+#define AMOEBA_BUFPOOL_H
+
+/*
+ * bufpool.h — reusable per-worker buffers
+ *
+ * Growable buffers that keep their high-water capacity between uses, so a
+ * worker's steady-state loop (build command line, capture output,
+ * tokenize) does not touch the heap. A WorkerBuffers is owned by exactly
+ * one thread; nothing here locks.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+    #endif
+
+    typedef struct {
+        char   *data;
+        size_t  len;
+        size_t  cap;
+    } ByteBuf;
+
+    typedef struct {
+        int    *data;
+        size_t  len;
+        size_t  cap;
+    } IntBuf;
+
+    typedef struct {
+        ByteBuf out;     /* captured command output */
+        ByteBuf cmd;     /* rendered command line */
+        ByteBuf args;    /* split copy of cmd for direct exec */
+        IntBuf  idx;     /* tokenized output (token/class ids) */
+        IntBuf  cands;   /* command construction candidate pool */
+    } WorkerBuffers;
+
+    /* Make room for at least `need` elements; keeps contents. 0 / -1 (OOM). */
+    int  bytebuf_reserve(ByteBuf *b, size_t need);
+    int  intbuf_reserve(IntBuf *b, size_t need);
+    void bytebuf_free(ByteBuf *b);
+    void intbuf_free(IntBuf *b);
+
+    void worker_buffers_init(WorkerBuffers *wb);
+    void worker_buffers_free(WorkerBuffers *wb);
+
+    /* Total bytes currently reserved by `wb`. */
+    size_t worker_buffers_bytes(const WorkerBuffers *wb);
+
+    /* Process-wide count of buffer growths (reallocs) so far. */
+    unsigned long bufpool_grows(void);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif /* AMOEBA_BUFPOOL_H */
@@ -14,6 +14,7 @@
 
 #include "model.h"   /* Words, CommandSettings */
 #include "config.h"  /* CMDMAX, IDX_TERMINATOR */
+#include "bufpool.h" /* IntBuf */
 
 #ifdef __cplusplus
 extern "C" {
@@ -25,6 +26,23 @@ extern "C" {
      * Fills out_cmd with up to settings->length token indices chosen from the
      * vocabulary (Words). Selection respects settings->scope (percentage
      * of vocabulary sampled) and clamps length to [CMDMIN..CMDMAX].
+     * The leading token is the best of FIRST_PICK_PROBES sampled candidates
+     * by per-executable stats (exestats.h); proven-dead leaders are skipped.
+     * With EXEC_ONLY_LEADERS, those candidates come from Words->exec_ids.
+     *
+     * With settings->budget_us > 0 construction is anytime: each position
+     * scores recent rewarded partners of the tokens already chosen first
+     * (Words->meta.nbr), then uniform random samples, and stops after
+     * CONSTRUCT_BUDGET_PROBES candidates or when the budget expires,
+     * keeping the best seen. Latency then stays flat as the vocabulary
+     * grows. With budget_us == 0 the whole scope window is scored.
+     *
+     * With settings->explore > 0 candidates are ranked UCB1-style: the mean
+     * association per joint execution (Words->pair_tries) plus a novelty
+     * bonus of explore * sqrt(ln N / (1 + n)) for rarely tried pairs, and
+     * for the leader its exestats prior plus the same bonus over the
+     * per-(token, position) counters in Words->meta.tries. With explore 0
+     * the raw cumulative association sums are used.
      *
      * on success:
      *   - out_cmd[0..(argc-1)] are valid indices into words->token
@@ -34,13 +52,21 @@ extern "C" {
      *   words     : vocabulary/association store (read-only access)
      *   settings  : length/scope parameters (read-only access)
      *   out_cmd   : caller-provided buffer of size CMDMAX+1
+     *   scratch   : optional reusable candidate pool (NULL = allocate per call)
      *
      * Returns:
      *   argc (number of arguments written, 0..CMDMAX)
      */
     int construct_command(const Words *words,
                           const CommandSettings *settings,
-                          int out_cmd[CMDMAX + 1]);
+                          int out_cmd[CMDMAX + 1],
+                          IntBuf *scratch);
+
+    /**
+     * Construction latency over all calls so far: median and 99th
+     * percentile in microseconds, and the number of calls.
+     */
+    void construct_latency(double *p50_us, double *p99_us, unsigned long *count);
 
     #ifdef __cplusplus
 } /* extern "C" */
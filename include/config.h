@@ -71,6 +71,11 @@
 #define SKIP_SYMLINKS 1
 #endif
 
+/* Draw the leading token only from tokens that resolve on PATH (1=yes). */
+#ifndef EXEC_ONLY_LEADERS
+#define EXEC_ONLY_LEADERS 1
+#endif
+
 /* =========================
  * Learning & scoring
  * ========================= */
@@ -83,11 +88,59 @@
 #define PENALTY 1
 #endif
 
+/* Execution cost model: rewards are divided (penalties multiplied) by
+ *   cost = 1 + wall/COST_WALL_UNIT_S + cpu/COST_CPU_UNIT_S + bytes/COST_BYTES_UNIT
+ * clamped to COST_MAX_FACTOR, so cheap commands keep their full value. */
+#ifndef COST_WALL_UNIT_S
+#define COST_WALL_UNIT_S 1.0
+#endif
+#ifndef COST_CPU_UNIT_S
+#define COST_CPU_UNIT_S 1.0
+#endif
+#ifndef COST_BYTES_UNIT
+#define COST_BYTES_UNIT (1024.0 * 1024.0)
+#endif
+#ifndef COST_MAX_FACTOR
+#define COST_MAX_FACTOR 16.0
+#endif
+
 /* Moving average window for learning values (lrnval). */
 #ifndef TREND_WINDOW_SIZE
 #define TREND_WINDOW_SIZE 10
 #endif
 
+/* Number of per-thread trend shards (one writer each; see model.h). */
+#ifndef TREND_SHARDS
+#define TREND_SHARDS MAX_THREADS
+#endif
+
+/* Multi-horizon trend statistics (all O(1) per sample, see trend.c):
+ *  - EWMAs of lrnval at several half-lives, in samples (fastest first);
+ *    analyze_learning_trend compares the first two once warmed up.
+ *  - one-second buckets (TREND_RATE_BUCKETS of them) aggregated into
+ *    time-based windows of TREND_TIME_WINDOWS_S seconds (shortest first). */
+#ifndef TREND_EWMA_COUNT
+#define TREND_EWMA_COUNT 3
+#endif
+#ifndef TREND_EWMA_HALFLIVES
+#define TREND_EWMA_HALFLIVES { 32, 256, 2048 }
+#endif
+#ifndef TREND_RATE_BUCKETS
+#define TREND_RATE_BUCKETS 64
+#endif
+#ifndef TREND_TIME_WINDOW_COUNT
+#define TREND_TIME_WINDOW_COUNT 3
+#endif
+#ifndef TREND_TIME_WINDOWS_S
+#define TREND_TIME_WINDOWS_S { 5, 15, 60 }
+#endif
+
+/* Wake the tuner after this many new lrnval samples (or on a trend flip);
+ * each writer merges the trend shards once per this many of its own. */
+#ifndef TUNER_SIGNAL_EVERY
+#define TUNER_SIGNAL_EVERY 16
+#endif
+
 /* % similarity at/above which a line is considered redundant. */
 #ifndef REDUNDANCY_THRESHOLD
 #define REDUNDANCY_THRESHOLD 75.0f
@@ -106,6 +159,79 @@
 #define STORE_REDUNDANT 1
 #endif
 
+/* Leading tokens of a line compared by the redundancy check. */
+#ifndef OBS_COMPARE_MAX
+#define OBS_COMPARE_MAX (CMDMAX * 4)
+#endif
+
+/* Tiered observation store (obsseg.h): once more than OBS_HOT_ROWS lines
+ * are in memory, the oldest OBS_SEGMENT_ROWS are sealed into an immutable
+ * segment file under OBS_SEGMENT_DIR and mapped read-only. 0 = keep every
+ * line in memory. */
+#ifndef OBS_HOT_ROWS
+#define OBS_HOT_ROWS 8192
+#endif
+#ifndef OBS_SEGMENT_ROWS
+#define OBS_SEGMENT_ROWS 4096
+#endif
+
+/* Per-executable statistics (keyed by leading token id, see exestats.h). */
+#ifndef EXESTATS_CAPACITY
+#define EXESTATS_CAPACITY 16384      /* table slots (power of two) */
+#endif
+#ifndef EXESTATS_DEAD_RUNS
+#define EXESTATS_DEAD_RUNS 8         /* always-failing leaders are skipped after N runs */
+#endif
+#ifndef EXESTATS_PRIOR_RUNS
+#define EXESTATS_PRIOR_RUNS 2        /* pseudo-runs at an optimistic REWARD/2 prior */
+#endif
+
+/* Anytime construction (construct_command with settings->budget_us > 0):
+ * candidates scored per position, and recent rewarded partners remembered
+ * per token (tried first). CONSTRUCT_BUDGET_US is the --budget-us default. */
+#ifndef CONSTRUCT_BUDGET_US
+#define CONSTRUCT_BUDGET_US 200
+#endif
+#ifndef CONSTRUCT_BUDGET_PROBES
+#define CONSTRUCT_BUDGET_PROBES 256
+#endif
+#ifndef NEIGHBOR_SLOTS
+#define NEIGHBOR_SLOTS 8
+#endif
+
+/* In-flight dedup (inflight.h): a worker whose command is already running
+ * elsewhere rebuilds up to INFLIGHT_RETRIES times before skipping a turn. */
+#ifndef INFLIGHT_DEDUP
+#define INFLIGHT_DEDUP 1
+#endif
+#ifndef INFLIGHT_RETRIES
+#define INFLIGHT_RETRIES 3
+#endif
+
+/* UCB1-style exploration (see construct_command): weight of the novelty
+ * bonus in reward units (the --explore default; 0 = plain cumulative
+ * association scores), and hashed per-pair try counters (trycount.h). */
+#ifndef EXPLORE_UCB_C
+#define EXPLORE_UCB_C 4.0
+#endif
+#ifndef EXPLORE_PAIR_SLOTS
+#define EXPLORE_PAIR_SLOTS (1 << 20)
+#endif
+
+/* Leading-token candidates scored by exestats per generated command. */
+#ifndef FIRST_PICK_PROBES
+#define FIRST_PICK_PROBES 8
+#endif
+
+/* A/B experiment mode (--arm, experiment.h): arms per run, and worker-
+ * seconds per batch (one sample for the confidence intervals). */
+#ifndef EXPERIMENT_MAX_ARMS
+#define EXPERIMENT_MAX_ARMS 4
+#endif
+#ifndef EXPERIMENT_BATCH_S
+#define EXPERIMENT_BATCH_S 2.0
+#endif
+
 /* =========================
  * Execution & runtime
  * ========================= */
@@ -117,6 +243,152 @@
 #define KILL_ATTEMPTS 3       /* escalation attempts (e.g., SIGTERM → SIGKILL) */
 #endif
 
+/* Output capture reads this much per read(2) straight into the worker's buffer. */
+#ifndef EXEC_READ_CHUNK
+#define EXEC_READ_CHUNK 4096
+#endif
+/* Initial capacity of a per-worker reusable buffer (bufpool.h). */
+#ifndef BUFPOOL_MIN_BYTES
+#define BUFPOOL_MIN_BYTES 4096
+#endif
+
+/* Re-stat PATH directories for cache invalidation at most this often. */
+#ifndef PATHCACHE_RECHECK_MS
+#define PATHCACHE_RECHECK_MS 1000
+#endif
+
+/* Commands containing any of these need /bin/sh; others are exec'd
+ * directly by resolved path (or skipped when the leader doesn't resolve). */
+#ifndef SHELL_METACHARS
+#define SHELL_METACHARS "|&;<>()$`\\\"'*?[]#~=%{}!\t\n"
+#endif
+
+/* Blocked Bloom filter in front of assoc_get (assoc.h). */
+#ifndef ASSOC_BLOOM
+#define ASSOC_BLOOM 1
+#endif
+#ifndef ASSOC_BLOOM_BITS_PER_KEY
+#define ASSOC_BLOOM_BITS_PER_KEY 8    /* per bucket, ~10.7 per key at 3/4 load */
+#endif
+#ifndef ASSOC_BLOOM_K
+#define ASSOC_BLOOM_K 6               /* bits set per key (<= 7) */
+#endif
+#ifndef ASSOC_BLOOM_STALE_DIV
+#define ASSOC_BLOOM_STALE_DIV 2       /* rebuild when deletes > live keys / DIV */
+#endif
+
+/* Token lookup table (toktab.h): initial slots and arena chunk size. */
+#ifndef TOKTAB_INITIAL_SLOTS
+#define TOKTAB_INITIAL_SLOTS 1024
+#endif
+#ifndef TOKTAB_ARENA_CHUNK
+#define TOKTAB_ARENA_CHUNK (64 * 1024)
+#endif
+
+/* Output classification (outclass.h): outputs judged binary are not
+ * tokenized; a first-seen blob earns BINARY_REWARD, a repeat -PENALTY. */
+#ifndef OUTCLASS_SAMPLE
+#define OUTCLASS_SAMPLE 4096          /* bytes inspected per output (head + middle) */
+#endif
+#ifndef OUTCLASS_MAX_INVALID
+#define OUTCLASS_MAX_INVALID 0.10     /* max share of invalid UTF-8 / control bytes */
+#endif
+#ifndef OUTCLASS_MAX_ENTROPY
+#define OUTCLASS_MAX_ENTROPY 7.2      /* bits per byte; compressed data is ~8 */
+#endif
+#ifndef OUTCLASS_MIN_ENTROPY_BYTES
+#define OUTCLASS_MIN_ENTROPY_BYTES 512 /* entropy test needs at least this sample */
+#endif
+#ifndef OUTCLASS_SEEN_CAPACITY
+#define OUTCLASS_SEEN_CAPACITY 65536  /* binary content hashes remembered */
+#endif
+#ifndef BINARY_REWARD
+#define BINARY_REWARD 1
+#endif
+
+/* Map volatile output tokens (numbers, hex, paths, times) to class ids
+ * before tokenization (normalize.h); --normalize 0|1 overrides. */
+#ifndef NORMALIZE_OUTPUT
+#define NORMALIZE_OUTPUT 1
+#endif
+#ifndef NORMALIZE_HEX_MIN
+#define NORMALIZE_HEX_MIN 8           /* shortest bare hex run treated as hex */
+#endif
+
+/* Vectorized (SSE2/AVX2) output splitting, chosen at runtime; 0 = scalar only. */
+#ifndef SPLIT_SIMD
+#define SPLIT_SIMD 1
+#endif
+
+/* --bench: size of the synthetic splitter input and timed repetitions. */
+#ifndef BENCH_SPLIT_MB
+#define BENCH_SPLIT_MB 64
+#endif
+#ifndef BENCH_REPS
+#define BENCH_REPS 5
+#endif
+/* --bench: token lookup table size, lookups per thread, max reader threads. */
+#ifndef BENCH_VOCAB
+#define BENCH_VOCAB 20000
+#endif
+#ifndef BENCH_LOOKUPS
+#define BENCH_LOOKUPS 2000000
+#endif
+#ifndef BENCH_MAX_THREADS
+#define BENCH_MAX_THREADS 8
+#endif
+/* --bench: association keys loaded and random pair probes issued. */
+#ifndef BENCH_ASSOC_KEYS
+#define BENCH_ASSOC_KEYS 200000
+#endif
+#ifndef BENCH_ASSOC_PROBES
+#define BENCH_ASSOC_PROBES 4000000
+#endif
+/* --bench: construct_command calls per vocabulary size, and scope used. */
+#ifndef BENCH_CONSTRUCT_CALLS
+#define BENCH_CONSTRUCT_CALLS 200
+#endif
+#ifndef BENCH_CONSTRUCT_SCOPE
+#define BENCH_CONSTRUCT_SCOPE 50
+#endif
+/* --bench: association rows dumped (plus a quarter as many observations). */
+#ifndef BENCH_PERSIST_ROWS
+#define BENCH_PERSIST_ROWS 1000000
+#endif
+
+/* --soak: report rows per run, output lines per fake command, the
+ * synthetic vocabulary the soak starts from, the command length it uses
+ * unless --length is given (2, so pairs are learned and associations
+ * grow), and the lowest acceptable exponent k in throughput ~
+ * observations^k. With SOAK_GATE 0 the exponent is only reported: the
+ * redundancy check still scans every hot line, so throughput falls about
+ * linearly while observations fit in the hot tier and the default run
+ * lands between about k = -0.7 and -0.9. Set SOAK_GATE 1 to fail the soak below the bound. */
+#ifndef SOAK_SAMPLES
+#define SOAK_SAMPLES 20
+#endif
+#ifndef SOAK_FAKE_LINES
+#define SOAK_FAKE_LINES 6
+#endif
+#ifndef SOAK_VOCAB
+#define SOAK_VOCAB 5000
+#endif
+#ifndef SOAK_LENGTH
+#define SOAK_LENGTH ((CMDMAX) < 2 ? (CMDMAX) : 2)
+#endif
+#ifndef SOAK_GATE
+#define SOAK_GATE 0
+#endif
+#ifndef SOAK_MIN_EXPONENT
+#define SOAK_MIN_EXPONENT (-0.5)
+#endif
+
+/* Live model memory (tokens, associations, observations, buffers, tables;
+ * see memacct.h) above which a one-time warning is printed. 0 = no budget. */
+#ifndef MEMORY_BUDGET_MB
+#define MEMORY_BUDGET_MB 0
+#endif
+
 /* =========================
  * Concurrency
  * ========================= */
@@ -141,11 +413,36 @@
 #ifndef OBSERVATIONS_FILE
 #define OBSERVATIONS_FILE "observations.csv"
 #endif
+/* Tuner, trend and exploration state for warm restarts (state.h). */
+#ifndef STATE_FILE
+#define STATE_FILE "state.txt"
+#endif
+/* Sealed observation segments (obsseg.h); OBSERVATIONS_FILE keeps the hot tier. */
+#ifndef OBS_SEGMENT_DIR
+#define OBS_SEGMENT_DIR "observations.d"
+#endif
+
+/* write_database: formatter threads per large section (0 = online CPUs,
+ * capped at MAX_THREADS), and rows (or assoc buckets) per chunk. */
+#ifndef PERSIST_THREADS
+#define PERSIST_THREADS 0
+#endif
+#ifndef PERSIST_CHUNK_ROWS
+#define PERSIST_CHUNK_ROWS 16384
+#endif
 
 /* =========================
  * Logging
  * ========================= */
 
+/* --trace: spans kept per thread (16 bytes each), and traced threads. */
+#ifndef TRACE_RING_EVENTS
+#define TRACE_RING_EVENTS 32768
+#endif
+#ifndef TRACE_MAX_THREADS
+#define TRACE_MAX_THREADS 64
+#endif
+
 #ifndef LOG_ACTIONS
 #define LOG_ACTIONS 1         /* 1 = print agent actions, 0 = quiet */
 #endif
@@ -154,6 +451,11 @@
 #define LOG_OUTPUT_PREVIEW 200 /* max bytes of command output to preview in logs */
 #endif
 
+/* Rows per table in the shutdown stats report. */
+#ifndef STATS_TOP_N
+#define STATS_TOP_N 10
+#endif
+
 /* Extra learning logs (e.g., redundancy decisions). */
 #ifndef VERBOSE_LOG
 #define VERBOSE_LOG 0
@@ -192,6 +494,12 @@
 #ifndef OBSERVATIONS_FILE
 #define OBSERVATIONS_FILE  DB_DIR "/observations.csv"
 #endif
+#ifndef STATE_FILE
+#define STATE_FILE         DB_DIR "/state.txt"
+#endif
+#ifndef OBS_SEGMENT_DIR
+#define OBS_SEGMENT_DIR    DB_DIR "/observations.d"
+#endif
 
 /* =========================
  * Sanity checks
@@ -209,6 +517,10 @@
 # error "CMDMIN must be <= CMDMAX"
 #endif
 
+#if (SOAK_LENGTH) < (CMDMIN) || (SOAK_LENGTH) > (CMDMAX)
+# error "SOAK_LENGTH must be within CMDMIN..CMDMAX"
+#endif
+
 #if (LINEBUFFER) <= 0
 # error "LINEBUFFER must be > 0"
 #endif
@@ -225,10 +537,38 @@
 # error "MAX_THREADS must be > 0"
 #endif
 
+#if (TREND_WINDOW_SIZE) < 2
+# error "TREND_WINDOW_SIZE must be >= 2 (recent/prior halves)"
+#endif
+
+#if (TREND_SHARDS) < (MAX_THREADS)
+# error "TREND_SHARDS must be >= MAX_THREADS (one single-writer shard per worker)"
+#endif
+
+#if (TREND_EWMA_COUNT) < 2
+# error "TREND_EWMA_COUNT must be >= 2 (fast vs slow trend)"
+#endif
+
+#if (ASSOC_BLOOM_K) < 1 || (ASSOC_BLOOM_K) > 7
+# error "ASSOC_BLOOM_K must be 1..7 (9 hash bits per probe from one 64-bit remix)"
+#endif
+
 #if (COMMANDS_PER_THREAD) <= 0
 # error "COMMANDS_PER_THREAD must be > 0"
 #endif
 
+#if (TRACE_RING_EVENTS) < 8 || (TRACE_MAX_THREADS) <= 0
+# error "TRACE_RING_EVENTS must be >= 8 and TRACE_MAX_THREADS > 0"
+#endif
+
+#if (OBS_HOT_ROWS) < 0 || (OBS_SEGMENT_ROWS) <= 0 || ((OBS_HOT_ROWS) > 0 && (OBS_SEGMENT_ROWS) > (OBS_HOT_ROWS))
+# error "OBS_SEGMENT_ROWS must be > 0 and <= OBS_HOT_ROWS (when OBS_HOT_ROWS > 0)"
+#endif
+
+#if (PERSIST_THREADS) < 0 || (PERSIST_CHUNK_ROWS) <= 0
+# error "PERSIST_THREADS must be >= 0 and PERSIST_CHUNK_ROWS > 0"
+#endif
+
 #if __STDC_VERSION__ >= 201112L
 _Static_assert(CMDMIN <= CMDMAX, "CMDMIN must be <= CMDMAX");
 _Static_assert(LINEBUFFER > 0, "LINEBUFFER must be > 0");
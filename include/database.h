@@ -19,6 +19,7 @@
  */
 
 #include "model.h"   /* Words, Observations */
+#include "bufpool.h" /* WorkerBuffers */
 #include "config.h"  /* file name defaults, limits */
 
 #ifdef __cplusplus
@@ -38,9 +39,22 @@ extern "C" {
     /**
      * Initialize an empty Observations store.
      * - Sets numObservations=0, entries=NULL, initializes mutex.
+     * - Every line stays in memory until attach_observation_segments.
      */
     void init_observations(Observations *observations);
 
+    /**
+     * Give the store a cold tier under `dir` (e.g., OBS_SEGMENT_DIR): map the
+     * segments already there, and from now on seal the oldest lines into new
+     * segments once more than OBS_HOT_ROWS are in memory (obsseg.h). The
+     * append that crosses the limit writes the segment, without holding
+     * observations->mutex. The directory is created on the first seal. Call before load_database so
+     * that a large observations file is sealed as it loads.
+     *
+     * Returns 0 on success, -1 on error (the store then stays all in memory).
+     */
+    int attach_observation_segments(Observations *observations, const char *dir);
+
     /**
      * Free all heap allocations owned by Words and Observations and destroy mutexes.
      * Safe to call on partially initialized structures.
@@ -59,6 +73,14 @@ extern "C" {
      */
     void reallocate_words(Words *words, int wordLength);
 
+    /**
+     * Add `tok` to the vocabulary unless it is already known.
+     * Returns its token index, or -1 on error.
+     *
+     * Thread-safe: locks words->mutex internally.
+     */
+    int add_word(Words *words, const char *tok);
+
     /**
      * Append a new observation line with capacity for `observationLength` tokens
      * plus a terminating IDX_TERMINATOR (-1). The caller should fill the new row.
@@ -67,13 +89,26 @@ extern "C" {
      */
     void reallocate_observations(Observations *observations, int observationLength);
 
+    /**
+     * Append `row` (heap-allocated, ending in IDX_TERMINATOR) as the newest
+     * observation line; ownership passes to the store on success. Accounted
+     * and sealed like the lines update_database stores.
+     * Returns 0, or -1 on OOM (the caller still owns `row`).
+     *
+     * Thread-safe: locks observations->mutex internally.
+     */
+    int append_observation(Observations *observations, int *row);
+
     /* =========================
      * Persistence
      * ========================= */
 
     /**
      * Load database files (tokens/values/observations). Existing contents are
-     * cleared first. Any NULL path uses the defaults from config.h.
+     * cleared first. A NULL or empty path skips that file; pass the
+     * defaults from config.h to load the usual database.
+     * Loaded tokens that resolve to an executable on PATH are flagged
+     * (TOK_EXEC in Words->meta.flags / exec_ids).
      *
      * Returns 0 on success, non-zero on error.
      */
@@ -84,11 +119,15 @@ extern "C" {
                       const char *observations_path); /* e.g., OBSERVATIONS_FILE */
 
     /**
-     * Save database to disk. Any NULL path uses the defaults from config.h.
+     * Save database to disk. A NULL or empty path skips that file.
      * On error, prints a message to stderr.
      *
      * values.csv is written sparsely: one line per non-zero entry:
      *   i,pi,k,pk,val
+     * The observations file holds the hot tier only; sealed segments are
+     * already on disk. Its first line, "#next-segment <seq>", lets the
+     * next load skip lines that segments sealed after this save already
+     * hold, so a run that dies before saving again loads none twice.
      */
     void write_database(const Words *words,
                         const Observations *observations,
@@ -106,17 +145,36 @@ extern "C" {
      *
      * - command_integers is a -1 terminated array of token indices that formed
      *   the executed command (positional length ≤ CMDMAX).
+     * - Numbers, hex, paths and times in the output are recorded as class
+     *   ids (normalize.h) rather than dropped, unless normalization is off.
      * - For each completed output line, a proximity-based redundancy check is used
-     *   (implemented in database.c via learning.h). New lines increase lrnval by
+     *   (implemented in database.c via learning.h) against the hot lines and,
+     *   through their indexes, the cold segments. New lines increase lrnval by
      *   REWARD; near-duplicates may incur PENALTY or scaled reward.
+     * - Output classified as binary (outclass.h; length from stats->out_bytes
+     *   when given) is not tokenized: a first-seen blob earns BINARY_REWARD
+     *   and counts as novel, a repeat is a PENALTY, and nothing is stored
+     *   in the observation lines.
+     * - Output with no known tokens and exit code 127 (command not found,
+     *   including commands the caller skipped without spawning) is a PENALTY.
+     * - The reward is then normalized by execution cost (see config.h COST_*):
+     *   positive values are divided by the cost factor, penalties multiplied.
+     *   stats may be NULL, in which case the flat reward is used.
      * - Updates the sparse association map with assoc_add(...) using lrnval.
+     * - out_novel (optional) is set to 1 when the output produced a new,
+     *   non-redundant observation line, else 0.
+     * - bufs (optional) supplies the caller's reusable scratch for the
+     *   tokenized output; only a stored observation line is allocated.
      *
      * Returns the lrnval accumulated for this update.
      */
     int update_database(Words *words,
                         Observations *observations,
                         char *output,
-                        int *command_integers);
+                        int *command_integers,
+                        const ExecStats *stats,
+                        int *out_novel,
+                        WorkerBuffers *bufs);
 
     /* =========================
      * Seeding
@@ -124,6 +182,8 @@ extern "C" {
 
     /**
      * Populate Words->token from executables found on PATH (or override).
+     * Every executable seen (new or already known) is flagged with
+     * TOK_EXEC in Words->meta.flags and listed in Words->exec_ids.
      * Returns number of tokens added (>=0), or -1 on fatal error.
      */
     int seed_vocabulary_from_path(Words *words, const char *path_env_override);
@@ -0,0 +1,59 @@
+#ifndef AMOEBA_DUMP_H
+#define AMOEBA_DUMP_H
+
+/*
+ * dump.h — chunked, parallel text formatting for database files
+ *
+ * A section of `nitems` items (assoc buckets, observation rows) is cut into
+ * chunks of PERSIST_CHUNK_ROWS. Each round, up to dump_threads() chunks are
+ * formatted concurrently into their own ByteBuf and then written to the
+ * file in order, so the output is byte-identical to a sequential dump and
+ * memory stays bounded by threads x chunk size.
+ *
+ * Thread-safety: the data being formatted must not change during a dump.
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+#include "bufpool.h"  /* ByteBuf */
+
+#ifdef __cplusplus
+extern "C" {
+    #endif
+
+    /**
+     * Append items [lo, hi) to `out` (out->len is the write position).
+     * Returns the number of rows produced, or -1 on allocation failure.
+     * Called concurrently for disjoint ranges.
+     */
+    typedef long (*DumpFormatFn)(ByteBuf *out, size_t lo, size_t hi, void *ctx);
+
+    /**
+     * Format items [0, nitems) with `fn` and write them to `fp` in order.
+     * Stores the total row count in *rows (may be NULL). Returns 0, or -1
+     * on allocation or write failure.
+     */
+    int dump_chunked(FILE *fp, size_t nitems, DumpFormatFn fn, void *ctx, size_t *rows);
+
+    /* Append the decimal form of `v` (out must have room for 11 bytes). */
+    static inline void dump_put_int(ByteBuf *out, int v) {
+        char tmp[12];
+        int n = 0;
+        unsigned int u = v < 0 ? 0u - (unsigned int)v : (unsigned int)v;
+        do { tmp[n++] = (char)('0' + u % 10); u /= 10; } while (u);
+        if (v < 0) tmp[n++] = '-';
+        char *p = out->data + out->len;
+        for (int i = 0; i < n; ++i) p[i] = tmp[n - 1 - i];
+        out->len += (size_t)n;
+    }
+
+    /* Formatter threads per section: PERSIST_THREADS, or the override below. */
+    int  dump_threads(void);
+    /* Override the formatter thread count (0 = back to the config default). */
+    void dump_set_threads(int n);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif /* AMOEBA_DUMP_H */
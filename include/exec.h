@@ -4,9 +4,10 @@
 /*
  * exec.h — process execution & signal handling
  *
- * This module runs a shell command, captures combined stdout/stderr,
- * and enforces a runtime limit. It also exposes a simple SIGINT/SIGTERM
- * handler that flips a global flag other modules can poll.
+ * This module runs a shell command (or a resolved executable directly),
+ * captures combined stdout/stderr, and enforces a runtime limit. It also
+ * exposes a simple SIGINT/SIGTERM handler that flips a global flag other
+ * modules can poll.
  *
  * Conventions:
  *  - execute_command(cmd) returns a heap-allocated NUL-terminated buffer
@@ -20,6 +21,8 @@
 
 #include <signal.h>    /* sig_atomic_t */
 #include <sys/types.h> /* pid_t */
+#include "model.h"     /* ExecStats */
+#include "bufpool.h"   /* ByteBuf */
 
 #ifdef __cplusplus
 extern "C" {
@@ -55,6 +58,36 @@ extern "C" {
      */
     char *execute_command(char cmd[]);
 
+    /**
+     * execute_command_stats
+     * ---------------------
+     * Same as execute_command, additionally reporting what the run cost:
+     * wall time, child CPU time (from wait4 rusage), captured output bytes
+     * and the exit code. `stats` may be NULL; it is filled on success and
+     * zeroed (exit_code = -1) on failure.
+     */
+    char *execute_command_stats(char cmd[], ExecStats *stats);
+
+    /**
+     * execute_argv_stats
+     * ------------------
+     * Like execute_command_stats, but execs `path` directly with `argv`
+     * (argv[0] first, NULL-terminated) instead of going through /bin/sh.
+     * Use when `path` is already resolved and no shell features are needed.
+     */
+    char *execute_argv_stats(const char *path, char *const argv[], ExecStats *stats);
+
+    /**
+     * execute_command_into / execute_argv_into
+     * ----------------------------------------
+     * Same as the _stats variants, but capture into the caller's reusable
+     * buffer `out` (grown as needed, out->len set) instead of a fresh heap
+     * block. The returned pointer is out->data: do NOT free it, and it is
+     * only valid until the buffer is reused. NULL on error.
+     */
+    char *execute_command_into(char cmd[], ByteBuf *out, ExecStats *stats);
+    char *execute_argv_into(const char *path, char *const argv[], ByteBuf *out, ExecStats *stats);
+
     /**
      * check_child_status
      * ------------------
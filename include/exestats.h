@@ -0,0 +1,94 @@
+#ifndef AMOEBA_EXESTATS_H
+#define AMOEBA_EXESTATS_H
+
+/*
+ * exestats.h — per-executable outcome statistics
+ *
+ * Fixed-capacity open-addressing table keyed by the leading token id of a
+ * command (cmd_indices[0]). Workers record outcomes lock-free (slots are
+ * claimed with CAS, counters are relaxed atomics); readers may see a
+ * slightly torn but always in-range view.
+ */
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+    #endif
+
+    /* log2 wall-time histogram: bucket 0 is <1 ms, bucket b is [2^(b-1), 2^b) ms */
+    #define EXESTATS_HIST_BUCKETS 16
+
+    typedef struct {
+        _Atomic int           key;          /* leading token id, -1 = empty slot */
+        _Atomic unsigned long runs;         /* commands executed with this leader */
+        _Atomic unsigned long novel;        /* runs that produced a new observation */
+        _Atomic unsigned long failures;     /* runs with a non-zero exit code */
+        _Atomic long          reward_sum;   /* sum of (cost-scaled) lrnval */
+        _Atomic unsigned long wall_us_sum;  /* total wall time (microseconds) */
+        _Atomic unsigned long out_bytes_sum;/* total captured output bytes */
+        _Atomic unsigned int  wall_hist[EXESTATS_HIST_BUCKETS];
+    } ExeStatsEntry;
+
+    typedef struct {
+        ExeStatsEntry *slots;     /* capacity entries */
+        size_t         capacity;  /* power of two */
+        _Atomic size_t used;      /* claimed slots */
+        _Atomic unsigned long dropped; /* records lost because the table was full */
+    } ExeStats;
+
+    /* Read-side summary of one entry. Percentiles are bucket upper bounds (ms). */
+    typedef struct {
+        unsigned long runs, novel, failures;
+        long          reward_sum;
+        double        mean_reward;
+        double        mean_wall_ms;
+        double        p50_wall_ms, p90_wall_ms, p99_wall_ms;
+        double        mean_out_bytes;
+    } ExeStatsView;
+
+    /* Raw counters of one entry, for persistence (state.h). */
+    typedef struct {
+        unsigned long runs, novel, failures;
+        long          reward_sum;
+        unsigned long wall_us_sum, out_bytes_sum;
+        unsigned int  wall_hist[EXESTATS_HIST_BUCKETS];
+    } ExeStatsCounts;
+
+    /* Initialize/teardown. capacity_hint 0 -> EXESTATS_CAPACITY. */
+    int  exestats_init(ExeStats *s, size_t capacity_hint);
+    void exestats_free(ExeStats *s);
+
+    /* Record one executed command led by `token`. Lock-free. */
+    void exestats_record(ExeStats *s, int token,
+                         double wall_s, size_t out_bytes, int exit_code,
+                         int reward, int novel);
+
+    /* Look up `token`. Returns 1 and fills `out` if present, else 0. */
+    int  exestats_get(const ExeStats *s, int token, ExeStatsView *out);
+
+    /**
+     * Generation prior for a leading token: smoothed mean reward per run,
+     * optimistic for unseen tokens. Sets *dead when the token has run at
+     * least EXESTATS_DEAD_RUNS times, always failed and never taught us
+     * anything, so callers can skip it.
+     */
+    double exestats_first_score(const ExeStats *s, int token, int *dead);
+
+    /* Iterate occupied slots from *cursor (start at 0). Returns 1 with the
+     * next entry's token/view and advances *cursor, or 0 when done. */
+    int  exestats_next(const ExeStats *s, size_t *cursor, int *token, ExeStatsView *out);
+
+    /* Like exestats_next, but yields the raw counters. */
+    int  exestats_next_counts(const ExeStats *s, size_t *cursor, int *token, ExeStatsCounts *out);
+
+    /* Add `c` to the entry for `token` (created if needed). Lock-free.
+     * Returns 0, or -1 if the table is full. */
+    int  exestats_add_counts(ExeStats *s, int token, const ExeStatsCounts *c);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif /* AMOEBA_EXESTATS_H */
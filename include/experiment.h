@@ -0,0 +1,93 @@
+#ifndef AMOEBA_EXPERIMENT_H
+#define AMOEBA_EXPERIMENT_H
+
+/*
+ * experiment.h — A/B comparison of generation settings within one run
+ *
+ * Each --arm SPEC adds an arm with its own CommandSettings; workers are
+ * dealt to arms round-robin (worker i runs arm i % narms). SPEC is a
+ * comma-separated list of overrides of the base settings:
+ *   explore=C    novelty bonus weight (0 = plain association scores)
+ *   budget=US    construction budget (0 = exhaustive greedy over the scope)
+ *   scope=P      vocabulary sampling scope (percent)
+ *   length=N     pin the command length; without it the arm follows the tuner
+ * e.g. --arm explore=0 --arm explore=4,budget=0.
+ *
+ * Every worker iteration is charged to its arm: new observations, the
+ * worker's wall time for the whole iteration (generate, run, learn) and
+ * the CPU it cost (worker thread plus child). Iterations that learn
+ * nothing count too: a failed exec, or no unique command to build (and
+ * the back-off sleep after it), so collisions and failures cost an arm
+ * worker-seconds rather than vanishing from its rate. Outcomes are grouped into
+ * batches of EXPERIMENT_BATCH_S worker-seconds per worker, and the report
+ * gives each arm's new observations per worker-second and per CPU-second
+ * with a 95% confidence interval over its batches, plus each arm's
+ * difference from the first arm (Welch). The learning state is shared,
+ * so arms learn from each other's outcomes; the comparison is between
+ * generation policies over the same evolving database.
+ *
+ * Thread-safety: experiment_note/experiment_flush may be called from any
+ * worker; arms are configured before the workers start.
+ */
+
+#include <stdio.h>
+#include <pthread.h>
+#include "config.h"
+#include "model.h"   /* CommandSettings */
+
+#ifdef __cplusplus
+extern "C" {
+    #endif
+
+    /* Outcomes of one batch, and a worker's running (unflushed) batch. */
+    typedef struct {
+        unsigned long runs;
+        double        novel;
+        double        wall_s;
+        double        cpu_s;
+    } ExpBatch;
+
+    typedef struct {
+        char            name[48];      /* the SPEC as given */
+        CommandSettings settings;      /* this arm's generation settings */
+        int             fixed_length;  /* 1 = length pinned by SPEC */
+        int             workers;       /* workers assigned */
+        pthread_mutex_t mutex;         /* protects batch/nbatch/cap */
+        ExpBatch       *batch;
+        size_t          nbatch, cap;
+    } ExpArm;
+
+    typedef struct Experiment {
+        ExpArm arm[EXPERIMENT_MAX_ARMS];
+        int    narms;
+    } Experiment;
+
+    void experiment_init(Experiment *e);
+    void experiment_free(Experiment *e);
+
+    /* Add an arm from SPEC on top of `base`. Returns its index, or -1 with a
+     * message on stderr (bad SPEC, or EXPERIMENT_MAX_ARMS reached). */
+    int  experiment_add_arm(Experiment *e, const char *spec, const CommandSettings *base);
+
+    /* Arm for worker `worker_id` (counted in its `workers`). */
+    int  experiment_assign(Experiment *e, int worker_id);
+
+    /* Charge one worker iteration to `arm` through the worker's running batch `acc`,
+     * which is handed over to the arm once it spans EXPERIMENT_BATCH_S. */
+    void experiment_note(Experiment *e, int arm, ExpBatch *acc,
+                         int novel, double wall_s, double cpu_s);
+
+    /* Hand over a partial batch (worker exit). */
+    void experiment_flush(Experiment *e, int arm, ExpBatch *acc);
+
+    /* Tuner hook: set the length of every arm that does not pin it. */
+    void experiment_follow_length(Experiment *e, int length);
+
+    /* Per-arm table with confidence intervals (nothing if no arms). */
+    void experiment_report(Experiment *e, FILE *fp);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif /* AMOEBA_EXPERIMENT_H */
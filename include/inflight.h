@@ -0,0 +1,55 @@
+#ifndef AMOEBA_INFLIGHT_H
+#define AMOEBA_INFLIGHT_H
+
+/*
+ * inflight.h — commands currently executing, shared across workers
+ *
+ * One cache-line sized slot per worker holds the 64-bit key of the command
+ * that worker is running (0 = idle). A worker publishes its key and then
+ * scans the other slots; if any holds the same key it withdraws and builds
+ * a different command instead of forking a duplicate. Publishing before
+ * scanning (both sequentially consistent) means two workers racing on the
+ * same command cannot both miss each other; at worst both withdraw.
+ * Distinct commands whose keys collide only cost a regeneration.
+ *
+ * Thread-safety: lock-free; each slot is written by its own worker only.
+ */
+
+#include <stdatomic.h>
+#include "config.h"   /* MAX_THREADS, CMDMAX */
+
+#ifdef __cplusplus
+extern "C" {
+    #endif
+
+    typedef struct {
+        _Alignas(64) _Atomic unsigned long long key;
+    } InFlightSlot;
+
+    typedef struct {
+        InFlightSlot slot[MAX_THREADS];
+    } InFlight;
+
+    void inflight_init(InFlight *f);
+
+    /* Key of an IDX_TERMINATOR-terminated command (never 0). */
+    unsigned long long inflight_key(const int cmd[CMDMAX + 1]);
+
+    /**
+     * Publish `key` as worker `worker`'s running command. Returns 1 if no
+     * other worker runs it, else 0 (slot left idle, duplicate counted).
+     */
+    int  inflight_claim(InFlight *f, int worker, unsigned long long key);
+    void inflight_release(InFlight *f, int worker);
+
+    /* Count a command dropped after INFLIGHT_RETRIES duplicates in a row. */
+    void inflight_note_gave_up(void);
+
+    /* Process-wide totals: duplicate executions avoided, and give-ups. */
+    void inflight_counts(unsigned long *avoided, unsigned long *gave_up);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif /* AMOEBA_INFLIGHT_H */
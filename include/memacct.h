@@ -0,0 +1,62 @@
+#ifndef AMOEBA_MEMACCT_H
+#define AMOEBA_MEMACCT_H
+
+/*
+ * memacct.h — per-structure memory accounting
+ *
+ * Every allocator path of the model (token strings and metadata, the
+ * lookup table, association entries and buckets, observation rows,
+ * worker buffers, the fixed-size tables) reports the bytes it requests
+ * and releases here, by kind. Each kind keeps a live total and its
+ * high-water mark, and so does the sum over all kinds. Counts are bytes
+ * requested from malloc, not malloc's own overhead, so RSS runs somewhat
+ * higher; a kind that does not return to 0 after teardown is a leak.
+ *
+ * With MEMORY_BUDGET_MB set, crossing the budget prints one warning.
+ *
+ * Thread-safety: relaxed atomics; callable from any thread.
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+    #endif
+
+    typedef enum {
+        MEM_TOKENS = 0,      /* token strings and the token pointer array */
+        MEM_TOKEN_META,      /* per-token metadata arrays, exec index */
+        MEM_LOOKUP,          /* token lookup table: slot arrays and arenas */
+        MEM_ASSOC_ENTRIES,   /* association entries */
+        MEM_ASSOC_INDEX,     /* association buckets and Bloom filter */
+        MEM_OBS_ROWS,        /* observation rows */
+        MEM_OBS_INDEX,       /* observation row pointer array */
+        MEM_BUFFERS,         /* worker scratch and output buffers (bufpool) */
+        MEM_TABLES,          /* pair tries, exestats, binary blob set */
+        MEM_KINDS
+    } MemKind;
+
+    /* Record `delta` bytes allocated (> 0) or released (< 0) for `kind`. */
+    void memacct_add(MemKind kind, long delta);
+
+    /* Live bytes and high-water mark of one kind (either out may be NULL). */
+    void memacct_get(MemKind kind, size_t *live, size_t *peak);
+
+    /* Live bytes and high-water mark summed over all kinds. */
+    void memacct_total(size_t *live, size_t *peak);
+
+    const char *memacct_name(MemKind kind);
+
+    /* One line per kind with its live and peak bytes, plus the total. */
+    void memacct_report(FILE *fp);
+
+    /* After teardown: name every kind with bytes still live on `fp`.
+     * Returns the total still live (0 = everything was released). */
+    size_t memacct_check_released(FILE *fp);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif /* AMOEBA_MEMACCT_H */
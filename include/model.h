@@ -9,13 +9,21 @@
  *   - Words:        vocabulary + sparse association map (Assoc)
  *   - Observations: learned output lines as token indices
  *   - CommandSettings: command-generation parameters
+ *   - ExecStats:    per-command execution cost (time, CPU, output size)
  *   - ThreadData:   bundle passed to worker threads
  */
 
 #include <stddef.h>     // size_t
 #include <pthread.h>    // pthread_mutex_t
+#include <stdatomic.h>  // lock-free trend shards
 #include "config.h"     // limits like CMDMAX
 #include "assoc.h"      // sparse (i,pi,k,pk) -> int map
+#include "exestats.h"   // per-leading-token outcome table
+#include "pathcache.h"  // token id -> resolved executable path
+#include "outclass.h"   // binary-output hash set
+#include "toktab.h"     // lock-free token -> id lookup
+#include "inflight.h"   // commands currently running, per worker
+#include "trycount.h"   // hashed per-pair try counters
 
 #ifdef __cplusplus
 extern "C" {
@@ -23,39 +31,124 @@ extern "C" {
 
     /* =========================
      * Learning trend tracker
-     * ========================= */
+     * =========================
+     * Samples land in per-thread shards (one writer each, no lock); every
+     * shard keeps its own ring plus running sums of the newest half-window
+     * ("recent") and the older half ("prior"), so a push is O(1) and readers
+     * merge the TREND_SHARDS shards. A writer only merges at checkpoints,
+     * every TUNER_SIGNAL_EVERY of its own samples, where it republishes the
+     * moving average through an atomic and may wake the tuner; the mutex/cond
+     * pair is only used for that wakeup.
+     * Shards also carry EWMAs at several half-lives and one-second buckets
+     * from which time-based windows and rates are derived on read.
+     */
     typedef struct {
-        int              window_size;     /* number of recent lrnval entries to consider */
-        int             *lrnvals;         /* circular buffer of recent lrnval values (length = window_size) */
-        int              index;           /* current write index in circular buffer */
-        int              count;           /* how many entries have been written (<= window_size) */
-        double           moving_average;  /* cached moving average */
-        pthread_mutex_t  mutex;           /* protects the structure */
+        _Atomic long      sec;                   /* monotonic second this bucket holds */
+        _Atomic long      n;                     /* samples in that second */
+        _Atomic long      sum;                   /* sum of their lrnvals */
+    } TrendBucket;
+
+    typedef struct {
+        _Alignas(64) _Atomic long head;          /* samples ever pushed into this shard */
+        _Atomic long      recent_sum;            /* sum of newest window/2 samples */
+        _Atomic long      prior_sum;             /* sum of the older samples still in window */
+        _Atomic int       lrnvals[TREND_WINDOW_SIZE]; /* circular buffer of recent lrnvals */
+        _Atomic double    ewma[TREND_EWMA_COUNT];     /* see TREND_EWMA_HALFLIVES */
+        TrendBucket       buckets[TREND_RATE_BUCKETS]; /* indexed by second % count */
+        int               since_check;           /* owner only: pushes since its last merge */
+        int               since_signal;          /* owner only: pushes since it last woke the tuner */
+    } TrendShard;
+
+    typedef struct {
+        int              window_size;     /* per-shard window (= TREND_WINDOW_SIZE) */
+        double           ewma_alpha[TREND_EWMA_COUNT]; /* per-sample decay, from half-lives */
+        double           start_s;         /* monotonic seconds at init; caps the rate windows */
+        TrendShard       shards[TREND_SHARDS];
+        unsigned long    id;              /* process-unique, set at init; keys writers' shard lookup */
+        _Atomic int      next_shard;      /* shard handed to the next new writer thread */
+        _Atomic double   moving_average;  /* merged moving average, republished at checkpoints */
+        _Atomic int      last_trend;      /* trend at the last checkpoint (-1/0/+1) */
+        int              pending;         /* wakeup posted but not yet consumed (mutex) */
+        int              shutdown;        /* set once; releases waiters for good (mutex) */
+        pthread_mutex_t  mutex;           /* protects pending/shutdown only */
+        pthread_cond_t   cond;            /* signaled on tuner events / shutdown */
     } LearningTrendTracker;
 
+    /* =========================
+     * Token metadata (structure of arrays)
+     * =========================
+     * Parallel to Words->token, one dense array per property so scans touch
+     * only the bytes they need. Arrays have `cap` >= numWords entries.
+     */
+    enum {
+        TOK_EXEC = 1u << 0,   /* resolves to an executable on PATH */
+        TOK_META = 1u << 1,   /* contains whitespace or SHELL_METACHARS */
+    };
+
+    typedef struct {
+        unsigned int   *len;    /* strlen(token[i]) */
+        unsigned char  *flags;  /* TOK_* bits */
+        unsigned int   *uses;   /* times used in an executed command */
+        int            *nbr;    /* NEIGHBOR_SLOTS ids per token: recent rewarded partners, -1 = empty */
+        unsigned char  *nbr_next; /* ring cursor into the token's nbr slots */
+        unsigned short *tries;  /* CMDMAX per token: executions with it at each position (saturating) */
+        size_t          cap;
+    } TokenMeta;
+
     /* =========================
      * Words database (sparse)
      * =========================
      * token: array of C-strings; token[i] is the ith known word
+     * meta:  per-token metadata arrays (see TokenMeta)
+     * lookup: text -> id table; lock-free reads, inserts under mutex
+     *         (hash and output-sighting counts live in its entries)
      * assoc: sparse association map for (i,pi,k,pk) -> value
+     * exestats: outcome statistics per leading token (lock-free, own atomics)
+     * exec_ids: dense index of TOK_EXEC tokens, used for position 0
+     * pos_tries/pair_tries: execution counts that drive exploration
      */
     typedef struct {
         char           **token;     /* length = numWords; each token[i] is malloc’d string */
         size_t          numWords;   /* current vocabulary size */
+        TokenMeta       meta;       /* parallel metadata arrays */
+        TokenTable      lookup;     /* readers need no lock */
+        int            *exec_ids;   /* token ids with TOK_EXEC set (length = numExec) */
+        size_t          numExec;
+        unsigned long   pos_tries[CMDMAX]; /* executions with any token at each position */
+        TryCount        pair_tries; /* executions per (token, pos, token, pos) pair */
         Assoc           assoc;      /* sparse association storage */
-        pthread_mutex_t mutex;      /* protects token/numWords/assoc */
+        ExeStats        exestats;   /* per-executable stats; not covered by mutex */
+        pthread_mutex_t mutex;      /* protects token/meta/numWords/assoc */
     } Words;
 
     /* =========================
      * Observations store
      * =========================
-     * entries: array of lines; each entries[line] is an int* of token indices
-     *          terminated by IDX_TERMINATOR (-1).
+     * entries: hot tier, the newest lines in memory; each entries[line] is an
+     *          int* of token indices terminated by IDX_TERMINATOR (-1).
+     * sealing: the oldest hot lines, detached while a worker writes them out
+     *          as segment sealSeq without holding the mutex; still in memory
+     *          and checked like hot lines until the segment is swapped in.
+     * segs:    cold tier, older lines sealed into mapped segment files under
+     *          segdir (obsseg.h), oldest first. With segdir NULL every line
+     *          stays hot.
+     * Lines are numbered cold, then sealing, then hot, oldest first.
+     * blobs:   content hashes of binary outputs, which are never tokenized
      */
+    struct ObsSegment;
+
     typedef struct {
-        int            **entries;          /* length = numObservations */
-        size_t           numObservations;  /* number of stored lines */
-        pthread_mutex_t  mutex;            /* protects entries/numObservations */
+        int              **entries;          /* length = numObservations */
+        size_t             numObservations;  /* lines in the hot tier */
+        int              **sealing;          /* length = numSealing; NULL when no seal is in flight */
+        size_t             numSealing;
+        unsigned int       sealSeq;          /* segment number sealing is written to */
+        struct ObsSegment *segs;             /* length = numSegments */
+        size_t             numSegments;
+        size_t             numCold;          /* lines in segs */
+        char              *segdir;           /* sealing target, or NULL */
+        BlobSet            blobs;            /* lock-free; not covered by mutex */
+        pthread_mutex_t    mutex;            /* protects both tiers */
     } Observations;
 
     /* =========================
@@ -63,13 +156,32 @@ extern "C" {
      * =========================
      * length: desired number of args in constructed command (bounded by [CMDMIN..CMDMAX])
      * scope:  percent of vocabulary to sample when building commands ([SRCHMIN..SRCHMAX])
+     * budget_us: per-command construction budget in microseconds; 0 scores
+     *         the whole sampled window (see construct_command)
+     * explore: weight of the novelty bonus for rarely tried tokens; 0 = off
      */
     typedef struct {
         int              length;
         int              scope;
+        int              budget_us;
+        double           explore;
         pthread_mutex_t  mutex;
     } CommandSettings;
 
+    /* =========================
+     * Execution cost report
+     * =========================
+     * Filled by the executor for every spawned command and consumed by the
+     * learner to normalize rewards by what the command cost us.
+     */
+    typedef struct {
+        double  wall_s;       /* wall-clock time from fork to reap (seconds) */
+        double  cpu_s;        /* child user+sys CPU time (seconds) */
+        size_t  out_bytes;    /* bytes of combined stdout/stderr captured */
+        int     exit_code;    /* exit status, 128+sig if signaled, -1 if unknown */
+        int     spawned;      /* 1 once a child was forked; 0 if the launch was skipped */
+    } ExecStats;
+
     /* =========================
      * Thread payload
      * =========================
@@ -80,6 +192,11 @@ extern "C" {
         Observations         *observations;
         CommandSettings      *settings;
         LearningTrendTracker *tracker;
+        PathCache            *pathcache;  /* optional; NULL = always use /bin/sh */
+        InFlight             *inflight;   /* optional; NULL = no duplicate check */
+        int                   worker_id;  /* 0..MAX_THREADS-1, this worker's inflight slot */
+        struct Experiment    *experiment; /* optional; NULL = no A/B arms (experiment.h) */
+        int                   arm;        /* this worker's arm; settings points at its settings */
     } ThreadData;
 
     #ifdef __cplusplus
@@ -0,0 +1,51 @@
+#ifndef AMOEBA_NORMALIZE_H
+#define AMOEBA_NORMALIZE_H
+
+/*
+ * normalize.h — volatile-token normalization for command output
+ *
+ * Maps output tokens that change from run to run (numbers and sizes, hex
+ * addresses and hashes, absolute/relative paths, times and dates) to a
+ * fixed class id so otherwise-identical lines compare equal in the
+ * redundancy check. Class ids are negative and never index Words->token;
+ * they only appear in observation lines.
+ *
+ * Thread-safety: the classifier is pure; the on/off switch and counters
+ * are atomics.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+    #endif
+
+    /* Class ids stored in observation lines (IDX_TERMINATOR is -1). */
+    enum {
+        TOKCLASS_NUM  = -2,   /* 42, -7, 3.14, 1,024, 12K, 99% */
+        TOKCLASS_HEX  = -3,   /* 0x7ffd1234, deadbeef01 */
+        TOKCLASS_PATH = -4,   /* /usr/bin/ls, ./a.out, ~/x */
+        TOKCLASS_TIME = -5,   /* 12:34:56, 2024-01-02, 2024-01-02T03:04:05Z */
+    };
+
+    #define TOKCLASS_COUNT 4
+
+    /* Class id for tok[0..len), or 0 if it is not a volatile token. */
+    int normalize_token_class(const char *tok, size_t len);
+
+    /* Enable/disable normalization (default: NORMALIZE_OUTPUT in config.h). */
+    void set_output_normalization(int on);
+    int  output_normalization_enabled(void);
+
+    /* Count one token mapped to `cls` / read the per-class counters. */
+    void normalize_note(int cls);
+    void normalize_counts(unsigned long out[TOKCLASS_COUNT]);
+
+    /* Short name of a class id ("num", "hex", ...) or "?". */
+    const char *tokclass_name(int cls);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif /* AMOEBA_NORMALIZE_H */
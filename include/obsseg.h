@@ -0,0 +1,93 @@
+#ifndef AMOEBA_OBSSEG_H
+#define AMOEBA_OBSSEG_H
+
+/*
+ * obsseg.h — immutable on-disk segments of observation lines (cold tier)
+ *
+ * Observations keeps its newest lines in memory; older ones are sealed in
+ * batches into segment files and mapped read-only, so their pages stay in
+ * the page cache and only the ones a query touches count toward RSS. A
+ * segment file (native endianness, written once, then renamed into place):
+ *
+ *   header   magic, version, nrows, nints, ntokens
+ *   sig      u64[nrows]      per-line token signature (one bit per token hash)
+ *   row_off  u32[nrows + 1]  start of each line in data[]
+ *   tokens   i32[ntokens]    sorted distinct tokens of the segment
+ *   data     i32[nints]      the lines, each ending in IDX_TERMINATOR
+ *
+ * Signatures and the token index cover the first OBS_COMPARE_MAX tokens
+ * of each line, the part the redundancy check scores. A line can only reach
+ * the threshold if enough of the probe's tokens occur in it, so a segment
+ * is skipped when too few of them occur in its token index, and a line is
+ * skipped when too few hit its signature; both are upper bounds, so the
+ * verdict is the same as scoring every line.
+ *
+ * Thread-safety: a mapped segment is read-only; callers serialize
+ * obsseg_open/obsseg_close against queries (Observations->mutex).
+ */
+
+#include <stddef.h>
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+    #endif
+
+    typedef struct ObsSegment {
+        unsigned int              seq;       /* file number (seg-<seq>.bin) */
+        size_t                    nrows, nints, ntokens;
+        void                     *map;
+        size_t                    map_len;
+        const unsigned long long *sig;
+        const unsigned int       *row_off;
+        const int                *tokens;
+        const int                *data;
+    } ObsSegment;
+
+    /* A line prepared for querying segments (see obsseg_probe_init). */
+    typedef struct {
+        const int         *line;
+        int                n;                         /* tokens scored */
+        int                need;                      /* matches needed to reach the threshold */
+        int                ndistinct;
+        int                tok[OBS_COMPARE_MAX];      /* distinct tokens of the line */
+        int                mult[OBS_COMPARE_MAX];     /* ... and how often each occurs */
+        unsigned long long mask;                      /* signature bits of the line */
+        int                weight[64];                /* line positions per signature bit */
+    } ObsProbe;
+
+    /* Signature of the first `max_len` tokens of a terminated line. */
+    unsigned long long obsseg_signature(const int *row, int max_len);
+
+    /* Path of segment `seq` under `dir` into buf; returns 0 or -1 if too long. */
+    int  obsseg_path(char *buf, size_t n, const char *dir, unsigned int seq);
+
+    /* Write `nrows` terminated lines as segment `seq` under `dir`. */
+    int  obsseg_write(const char *dir, unsigned int seq, int *const *rows, size_t nrows);
+
+    /* Map segment `seq` under `dir` and check its layout, down to each
+     * line's terminator. 0 or -1. */
+    int  obsseg_open(ObsSegment *s, const char *dir, unsigned int seq);
+    void obsseg_close(ObsSegment *s);
+
+    void obsseg_probe_init(ObsProbe *p, const int *line, int n, float threshold_percent);
+
+    /**
+     * Redundancy check of a probe against one segment, scoring like
+     * is_redundant_line_proximity (learning.h) but only the lines that can
+     * still reach the threshold. Updates *best_score and *best_row when a scored line
+     * beats *best_score. Returns 1 once a line reaches the threshold.
+     */
+    int  obsseg_redundant(const ObsSegment *s, const ObsProbe *p, float threshold_percent,
+                          size_t *best_row, float *best_score);
+
+    /* Process-wide query counters: segments consulted and skipped by their
+     * token index, lines skipped by signature, lines scored. */
+    void obsseg_counts(unsigned long *checked, unsigned long *skipped,
+                       unsigned long *filtered, unsigned long *scored);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif /* AMOEBA_OBSSEG_H */
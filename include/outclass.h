@@ -0,0 +1,56 @@
+#ifndef AMOEBA_OUTCLASS_H
+#define AMOEBA_OUTCLASS_H
+
+/*
+ * outclass.h — captured output classification
+ *
+ * Decides from a bounded sample whether command output is text worth
+ * tokenizing or binary/garbage (NUL bytes, mostly invalid UTF-8, or
+ * near-random byte entropy such as compressed data). Binary output is not
+ * tokenized; it is deduplicated by a content hash in a BlobSet instead.
+ *
+ * Thread-safety: classify_output/blob_hash are pure; BlobSet is lock-free
+ * (slots claimed with CAS).
+ */
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+    #endif
+
+    typedef enum {
+        OUTPUT_TEXT = 0,
+        OUTPUT_BINARY,
+    } OutputClass;
+
+    typedef struct {
+        _Atomic unsigned long *slots;     /* content hashes, 0 = empty */
+        size_t                 capacity;  /* power of two */
+        _Atomic size_t         used;
+    } BlobSet;
+
+    /**
+     * Classify buf[0..len) by looking at most OUTCLASS_SAMPLE bytes
+     * (head and middle of the buffer; config.h thresholds).
+     */
+    OutputClass classify_output(const char *buf, size_t len);
+
+    /* 64-bit content hash of buf[0..len) (never 0). */
+    unsigned long blob_hash(const char *buf, size_t len);
+
+    int  blobset_init(BlobSet *s, size_t capacity_hint);
+    void blobset_free(BlobSet *s);
+
+    /**
+     * Insert `hash`. Returns 1 if it was not present before, 0 if it was
+     * (or the set is full, so a flood of distinct blobs is not rewarded).
+     */
+    int  blobset_insert(BlobSet *s, unsigned long hash);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif /* AMOEBA_OUTCLASS_H */
@@ -0,0 +1,59 @@
+#ifndef AMOEBA_PATHCACHE_H
+#define AMOEBA_PATHCACHE_H
+
+/*
+ * pathcache.h — PATH resolution cache for leading tokens
+ *
+ * Maps a token id to the absolute path its name resolves to on PATH, or
+ * to "not found". The whole cache is dropped when the mtime of any PATH
+ * directory changes (checked at most every PATHCACHE_RECHECK_MS).
+ * Lets the worker skip spawning commands that cannot run and exec the
+ * ones that can directly, without the shell's PATH search.
+ *
+ * Thread-safety: all functions lock the cache mutex internally.
+ */
+
+#include <stddef.h>
+#include <pthread.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+    #endif
+
+    #define PATHCACHE_MAX_DIRS 256
+
+    typedef struct {
+        char            *pathbuf;          /* strdup of PATH; dirs[] point into it */
+        char            *dirs[PATHCACHE_MAX_DIRS];
+        struct timespec  dir_mtime[PATHCACHE_MAX_DIRS]; /* {0,0} if stat failed */
+        int              ndirs;
+        char           **paths;            /* per token id: NULL = unknown, else see .c */
+        size_t           cap;              /* length of paths[] */
+        double           last_check;       /* monotonic seconds of last mtime check */
+        unsigned long    hits, misses, invalidations;
+        pthread_mutex_t  mutex;
+    } PathCache;
+
+    /* Initialize from `path_env` (NULL -> getenv("PATH") or a default). */
+    int  pathcache_init(PathCache *pc, const char *path_env);
+    void pathcache_free(PathCache *pc);
+
+    /**
+     * Resolve token `id` named `name`. On success copies the absolute path
+     * into out[outsz] and returns 1; returns 0 if it does not resolve.
+     * Names containing '/' are checked as paths and returned unchanged.
+     */
+    int  pathcache_resolve(PathCache *pc, int id, const char *name, char *out, size_t outsz);
+
+    /**
+     * Stateless lookup of `name` in `dirs` (no caching). Same return and
+     * out conventions as pathcache_resolve.
+     */
+    int  path_lookup(char *const *dirs, int ndirs, const char *name, char *out, size_t outsz);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif /* AMOEBA_PATHCACHE_H */
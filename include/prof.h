@@ -0,0 +1,65 @@
+#ifndef AMOEBA_PROF_H
+#define AMOEBA_PROF_H
+
+/*
+ * prof.h — optional per-stage profiling with hardware counters
+ *
+ * With profiling enabled (--profile), each thread lazily opens one
+ * perf_event_open group on itself (cycles, instructions, LLC misses,
+ * branch misses; user space only) and prof_begin/prof_end attribute the
+ * counter deltas and wall time between them to a pipeline stage.
+ * Counters the kernel refuses (no PMU in a VM, perf_event_paranoid,
+ * seccomp) are left out, down to wall time only; the report says which.
+ * When the kernel multiplexes the group with other events, deltas are
+ * scaled by time enabled / time running and the report says so.
+ * Disabled, prof_begin/prof_end cost one relaxed load.
+ *
+ * Counts are per thread, so a stage that fans out to helper threads
+ * (persistence) is charged for the calling thread's share only.
+ *
+ * Thread-safety: per-thread state; totals are relaxed atomics.
+ */
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+    #endif
+
+    typedef enum {
+        PROF_CONSTRUCT = 0,   /* construct_command */
+        PROF_TOKENIZE,        /* output classification + tokenization */
+        PROF_REDUNDANCY,      /* redundancy scan over stored observations */
+        PROF_ASSOC,           /* assoc_add / counter updates under words->mutex */
+        PROF_PERSIST,         /* write_database */
+        PROF_STAGES
+    } ProfStage;
+
+    enum { PROF_CYCLES = 0, PROF_INSTRUCTIONS, PROF_LLC_MISSES, PROF_BRANCH_MISSES, PROF_COUNTERS };
+
+    /* Snapshot taken by prof_begin; opaque to callers. */
+    typedef struct {
+        unsigned long long v[PROF_COUNTERS];
+        unsigned long long enabled, running;   /* group time enabled / on the PMU (ns) */
+        double             t;
+        int                on;
+    } ProfMark;
+
+    void prof_enable(int on);
+    int  prof_enabled(void);
+
+    void prof_begin(ProfMark *m);
+    void prof_end(ProfStage stage, const ProfMark *m);
+
+    /* Close this thread's counters (call before a profiled thread exits,
+     * the main thread included). */
+    void prof_thread_exit(void);
+
+    /* Print the per-stage table (nothing if profiling was never enabled). */
+    void prof_report(FILE *fp);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif /* AMOEBA_PROF_H */
@@ -0,0 +1,46 @@
+#ifndef AMOEBA_SOAK_H
+#define AMOEBA_SOAK_H
+
+/*
+ * soak.h — long-run scaling harness (amoeba --soak SECONDS)
+ *
+ * Drives the real pipeline (construct_command, update_database, trend
+ * tracker) on one thread against a fake executor: a command's "output"
+ * is a deterministic function of its token ids, a mix of known tokens
+ * (skewed toward a popular head), filler and numbers, so observations
+ * and associations keep growing the way they do over hours of real runs.
+ * Each fake run advances a simulated clock by a modeled wall time; the
+ * soak stops once SECONDS of simulated time have passed (or on Ctrl-C).
+ *
+ * Every SECONDS / SOAK_SAMPLES simulated seconds a row is printed: model
+ * size, real commands/s of the pipeline itself, mean and worst stage
+ * latencies, RSS and the model memory accounted by memacct.h. The summary
+ * fits throughput ~ observations^k and RSS per observation. A k below
+ * SOAK_MIN_EXPONENT is noted, and fails the soak when built with
+ * SOAK_GATE 1 (off by default, see config.h); any accounted memory left
+ * after teardown always fails it.
+ *
+ * Starts from SOAK_VOCAB synthetic tokens and an otherwise empty
+ * database, with commands of SOAK_LENGTH tokens unless `settings` says
+ * otherwise; no commands are spawned, and the worker threads, in-flight
+ * dedup and tuner are not exercised. Observation segments (obsseg.h) go
+ * to a temporary directory that is removed at the end.
+ */
+
+#include <stdio.h>
+#include "model.h"   /* CommandSettings */
+
+#ifdef __cplusplus
+extern "C" {
+    #endif
+
+    /* Run the soak; `settings` supplies length/scope/budget/explore.
+     * Returns 0, or 1 if memory is still accounted after teardown or, with
+     * SOAK_GATE, the throughput exponent is below SOAK_MIN_EXPONENT. */
+    int run_soak(FILE *fp, double sim_seconds, const CommandSettings *settings);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif /* AMOEBA_SOAK_H */
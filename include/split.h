@@ -0,0 +1,51 @@
+#ifndef AMOEBA_SPLIT_H
+#define AMOEBA_SPLIT_H
+
+/*
+ * split.h — whitespace splitter for command output
+ *
+ * Walks a buffer and hands each maximal run of non-whitespace bytes
+ * (delimiters: space, tab, CR, LF) to a callback as a (pointer, length)
+ * span into the original buffer; nothing is modified or copied.
+ * On x86 the buffer is scanned 16 (SSE2) or 32 (AVX2) bytes at a time by
+ * comparing against the delimiters and walking the resulting movemask;
+ * the widest variant the CPU supports is picked once at first use.
+ *
+ * Thread-safety: stateless; safe to call concurrently.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+    #endif
+
+    typedef enum {
+        SPLIT_SCALAR = 0,   /* byte-at-a-time reference */
+        SPLIT_SSE2,         /* 16-byte compare + movemask */
+        SPLIT_AVX2,         /* 32-byte compare + movemask */
+        SPLIT_IMPLS
+    } SplitImpl;
+
+    /* Called per token; return non-zero to stop splitting early. */
+    typedef int (*SplitFn)(const char *tok, size_t len, void *ctx);
+
+    /**
+     * Split buf[0..len) with the best available implementation.
+     * Returns the number of tokens passed to `fn`.
+     */
+    size_t split_whitespace(const char *buf, size_t len, SplitFn fn, void *ctx);
+
+    /* Same, forcing `impl` (falls back to scalar if it is unavailable). */
+    size_t split_whitespace_with(SplitImpl impl, const char *buf, size_t len,
+                                 SplitFn fn, void *ctx);
+
+    int         split_impl_available(SplitImpl impl);
+    const char *split_impl_name(SplitImpl impl);
+    SplitImpl   split_active_impl(void);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif /* AMOEBA_SPLIT_H */
@@ -0,0 +1,54 @@
+#ifndef AMOEBA_STATE_H
+#define AMOEBA_STATE_H
+
+/*
+ * state.h — warm-restart state kept next to the database
+ *
+ * What the agent adapts besides the database proper: the tuned command
+ * length, the learning trend (trend.h TrendState), the exploration
+ * counters (per-position, per-token and per-pair tries) and the
+ * per-executable statistics. Written at shutdown and loaded at startup,
+ * so a restarted run resumes at its previous steady state instead of
+ * spending its first phase rediscovering it.
+ *
+ * Format: text, one record per line led by a keyword, after a version
+ * line. Unknown keywords are skipped. Token ids are positions in
+ * TOKENS_FILE, so token-keyed records (tries, pair, exe) are only applied
+ * when the loaded vocabulary has the size it had when the state was saved.
+ *
+ * Not saved: the --arm batches (experiment.h). An A/B comparison covers
+ * one run, and a restart may bring different arms, so every run starts
+ * its arms from zero.
+ *
+ * Thread-safety: none; call while no worker is running.
+ */
+
+#include "model.h"
+
+#ifdef __cplusplus
+extern "C" {
+    #endif
+
+    /**
+     * Load `path` (NULL = STATE_FILE) into the given structures; any of
+     * settings/tracker may be NULL to skip that part. Call after
+     * load_database and init_trend_tracker. A missing file is not an error.
+     *
+     * Returns 0 on success (or no file), -1 if the file is unreadable or
+     * of an unknown version; the structures are then left as they were.
+     */
+    int  load_state(Words *words, CommandSettings *settings,
+                    LearningTrendTracker *tracker, const char *path);
+
+    /**
+     * Write the state to `path` (NULL = STATE_FILE) through a temporary
+     * file renamed into place. Returns 0, or -1 on error (reported on stderr).
+     */
+    int  write_state(const Words *words, const CommandSettings *settings,
+                     const LearningTrendTracker *tracker, const char *path);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif /* AMOEBA_STATE_H */
@@ -0,0 +1,50 @@
+#ifndef AMOEBA_STATS_H
+#define AMOEBA_STATS_H
+
+/*
+ * stats.h — runtime statistics report
+ *
+ * Single place that renders what the modules measure (per-executable
+ * outcomes, spawn results, token usage, ...) into a human-readable report. Safe to
+ * call while workers are running; counters are lock-free atomics.
+ */
+
+#include <stdio.h>
+#include "model.h"   /* Words, Observations */
+#include "outclass.h" /* OutputClass */
+
+#ifdef __cplusplus
+extern "C" {
+    #endif
+
+    /* How a generated command was launched (see threads.c). */
+    typedef enum {
+        STATS_LAUNCH_SHELL = 0,   /* via /bin/sh -c */
+        STATS_LAUNCH_DIRECT,      /* execv of the PATH-resolved leader */
+        STATS_LAUNCH_SKIPPED,     /* leader did not resolve; not spawned */
+        STATS_LAUNCH_KINDS
+    } StatsLaunch;
+
+    /* Count one command by launch kind. */
+    void stats_note_launch(StatsLaunch kind);
+
+    /**
+     * Count one spawned command by its exit code (exit 127 = the shell
+     * could not find the leading command).
+     */
+    void stats_note_spawn(int exit_code);
+
+    /* Count one captured output of `bytes` bytes by its classification. */
+    void stats_note_output(OutputClass cls, size_t bytes);
+
+    /**
+     * Print the statistics report to `fp`. Tables list at most STATS_TOP_N
+     * rows each (config.h). `observations` may be NULL.
+     */
+    void print_stats_report(FILE *fp, const Words *words, const Observations *observations);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif /* AMOEBA_STATS_H */
@@ -4,12 +4,12 @@
 #include <stdio.h>     /* fprintf for LOG_ACTIONS */
 #include <pthread.h>
 #include <signal.h>
-#include <unistd.h>    /* usleep */
 #include "config.h"
 #include "model.h"     /* CommandSettings, ThreadData (already defined here) */
 #include "trend.h"     /* LearningTrendTracker */
+#include "experiment.h" /* arms that follow the tuned length */
 
-/* Exposed by exec.c; used to stop the tuner loop */
+/* Exposed by exec.c; checked by the tuner after each wakeup */
 extern volatile sig_atomic_t termination_requested;
 
 /* ------------ Existing API (unchanged) ------------ */
@@ -23,8 +23,8 @@ void* worker_thread(void *arg);
 
 typedef struct TunerArgs {
     CommandSettings *settings;           /* protected by settings->mutex */
-    LearningTrendTracker *tracker;       /* trend source */
-    int interval_ms;                     /* how often to adjust */
+    LearningTrendTracker *tracker;       /* trend source; wakes us via wait_trend_event */
+    Experiment *experiment;              /* optional; arms without a pinned length follow */
 } TunerArgs;
 
 /* Small helper: clamp and set length with mutex */
@@ -35,31 +35,31 @@ static inline void tuner_set_length_locked(CommandSettings *s, int new_len) {
     s->length = new_len;
 }
 
-/* Inline implementation so you don’t need a new .c file */
+/* Inline implementation so you don’t need a new .c file.
+ * Event-driven: sleeps on the tracker's condition variable until it has
+ * new samples (or a trend flip) and exits as soon as the tracker shuts down. */
 static inline void* tuner_thread(void *arg) {
     TunerArgs *ta = (TunerArgs *)arg;
     if (!ta || !ta->settings || !ta->tracker) return NULL;
 
-    /* optional warm-up read */
-    (void)get_moving_average(ta->tracker);
-
-    while (!termination_requested) {
+    while (wait_trend_event(ta->tracker) == 0 && !termination_requested) {
         int adj = analyze_learning_trend(ta->tracker);   /* >0 up, <0 down, 0 flat */
 
         if (adj != 0) {
             pthread_mutex_lock(&ta->settings->mutex);
             int cur = ta->settings->length;
             tuner_set_length_locked(ta->settings, cur + (adj > 0 ? 1 : -1));
+            experiment_follow_length(ta->experiment, ta->settings->length);
             #if LOG_ACTIONS
-            fprintf(stdout, "[tuner] length %s to %d\n",
+            TrendSnapshot snap;
+            get_trend_snapshot(ta->tracker, &snap);
+            fprintf(stdout, "[tuner] length %s to %d (ewma %.2f/%.2f, %.1f cmd/s)\n",
                     (adj > 0 ? "↑" : "↓"),
-                    ta->settings->length);
+                    ta->settings->length,
+                    snap.ewma[0], snap.ewma[1], snap.window_rate[0]);
             #endif
             pthread_mutex_unlock(&ta->settings->mutex);
         }
-
-        if (ta->interval_ms <= 0) ta->interval_ms = 1500;
-        usleep((useconds_t)ta->interval_ms * 1000);
     }
 
     #if LOG_ACTIONS
@@ -0,0 +1,73 @@
+#ifndef AMOEBA_TOKTAB_H
+#define AMOEBA_TOKTAB_H
+
+/*
+ * toktab.h — token string -> id lookup with lock-free readers
+ *
+ * Open-addressing table of pointers to immutable entries. Entries (hash,
+ * id, text) live in an append-only arena and never move, so a reader that
+ * found one can keep using it. A single writer (serialized by the caller,
+ * e.g. under Words->mutex) publishes new entries with release stores;
+ * growth builds a bigger slot array and swaps it in atomically, keeping
+ * the old arrays until toktab_free so in-flight readers stay valid.
+ *
+ * Thread-safety: toktab_lookup/toktab_hash may run concurrently with one
+ * toktab_insert. init/free must not race with anything.
+ */
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+    #endif
+
+    typedef struct {
+        unsigned long          hash;
+        int                    id;
+        unsigned int           len;
+        _Atomic unsigned long  hits;   /* lookups that matched (output sightings) */
+        char                   str[];  /* NUL-terminated copy of the token */
+    } TokEntry;
+
+    typedef struct TokSlots {
+        struct TokSlots     *retired;  /* previous (smaller) array, kept for readers */
+        size_t               mask;     /* capacity - 1 */
+        _Atomic(TokEntry *)  slot[];
+    } TokSlots;
+
+    typedef struct TokArena TokArena;
+
+    typedef struct {
+        _Atomic(TokSlots *) slots;
+        size_t              count;        /* entries inserted (writer only) */
+        TokArena           *arena;        /* entry storage chunks */
+        size_t              arena_bytes;  /* bytes reserved by the arena */
+    } TokenTable;
+
+    /* FNV-1a 64 of s[0..n). */
+    unsigned long toktab_hash(const char *s, size_t n);
+
+    int  toktab_init(TokenTable *t, size_t capacity_hint);
+    void toktab_free(TokenTable *t);
+
+    /**
+     * Insert token s[0..n) with id `id`. Writer side: calls must be
+     * serialized. Does not check for duplicates. Returns 0, or -1 on OOM.
+     */
+    int  toktab_insert(TokenTable *t, const char *s, size_t n, int id);
+
+    /**
+     * Lock-free lookup; returns the entry or NULL if s[0..n) is unknown.
+     * Only the entry's `hits` counter may be modified (atomically).
+     */
+    TokEntry *toktab_lookup(const TokenTable *t, const char *s, size_t n);
+
+    /* Bytes used by slot arrays (current and retired) plus the arena. */
+    size_t toktab_bytes(const TokenTable *t);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif /* AMOEBA_TOKTAB_H */
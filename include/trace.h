@@ -0,0 +1,71 @@
+#ifndef AMOEBA_TRACE_H
+#define AMOEBA_TRACE_H
+
+/*
+ * trace.h — pipeline spans exported as Chrome / Perfetto trace JSON
+ *
+ * With tracing enabled (--trace FILE) each thread records complete spans
+ * (start, duration, kind) into its own ring of TRACE_RING_EVENTS entries;
+ * a span costs two clock reads and one store, with no lock and no
+ * allocation after the ring exists. Mutex waits are only recorded when
+ * the lock was actually contended (trylock failed).
+ * trace_write renders every ring as "X" (complete) events, oldest first,
+ * loadable in chrome://tracing or ui.perfetto.dev. It runs at shutdown,
+ * and on SIGUSR1 from the next worker to reach the top of its loop.
+ *
+ * Thread-safety: rings have one writer each. A dump taken while workers
+ * run may show the oldest few spans of a busy ring torn; the newest
+ * TRACE_RING_EVENTS * 7/8 are always intact.
+ */
+
+#include <stdint.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+    #endif
+
+    typedef enum {
+        TRACE_GENERATE = 0,   /* construct_command (+ in-flight dedup) */
+        TRACE_SPAWN,          /* pipe + fork */
+        TRACE_WAIT,           /* poll on the child's output */
+        TRACE_CAPTURE,        /* reading output */
+        TRACE_LEARN,          /* update_database */
+        TRACE_LOCK_WORDS,     /* contended wait for words->mutex */
+        TRACE_LOCK_OBS,       /* contended wait for obs->mutex */
+        TRACE_KINDS
+    } TraceKind;
+
+    /* Enable tracing to `path` (NULL = off). Call before threads start. */
+    void trace_enable(const char *path);
+    int  trace_enabled(void);
+
+    /* Name this thread's track in the trace (copied; optional). */
+    void trace_thread_name(const char *name);
+
+    /* Start of a span in ns (0 when tracing is off); pass it to trace_end. */
+    uint64_t trace_begin(void);
+    void     trace_end(TraceKind kind, uint64_t start);
+
+    /* pthread_mutex_lock that records a TRACE_LOCK_* span if it had to wait. */
+    void trace_lock(pthread_mutex_t *m, TraceKind kind);
+
+    /* Write all rings to the trace file. Returns 0, or -1 on error. */
+    int  trace_write(void);
+
+    /* Free every ring and turn tracing off. Rings outlive their threads so
+     * the exit dump still has them; call this after the last trace_write,
+     * once no other thread records spans. */
+    void trace_free(void);
+
+    /* SIGUSR1 handler: request a dump (async-signal-safe). */
+    void trace_signal_handler(int signum);
+
+    /* Dump if a SIGUSR1 arrived since the last call; cheap otherwise. */
+    void trace_poll_dump(void);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif /* AMOEBA_TRACE_H */
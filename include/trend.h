@@ -4,8 +4,10 @@
 /*
  * trend.h — moving-average tracking of learning value (lrnval)
  *
- * Utilities to maintain a circular buffer of recent lrnval samples,
+ * Utilities to maintain circular buffers of recent lrnval samples,
  * compute a moving average, and provide a coarse trend indication.
+ * Each writer thread pushes into its own shard without locking; reads
+ * merge the shards (see model.h).
  *
  * The underlying struct (LearningTrendTracker) is defined in model.h.
  */
@@ -16,10 +18,42 @@
 extern "C" {
     #endif
 
+    /**
+     * Multi-horizon view of the tracker, merged over all shards.
+     *   ewma[i]        : EWMA of lrnval with half-life TREND_EWMA_HALFLIVES[i] samples
+     *   window_s[i]    : length of time window i (TREND_TIME_WINDOWS_S[i] seconds)
+     *   window_mean[i] : mean lrnval over that window (0 if no samples)
+     *   window_rate[i] : samples per second over that window, or over the
+     *                    tracker's uptime while that is shorter
+     *   samples        : total samples ever pushed
+     */
+    typedef struct {
+        double ewma[TREND_EWMA_COUNT];
+        int    window_s[TREND_TIME_WINDOW_COUNT];
+        double window_mean[TREND_TIME_WINDOW_COUNT];
+        double window_rate[TREND_TIME_WINDOW_COUNT];
+        long   samples;
+    } TrendSnapshot;
+
+    /**
+     * Persistable summary of a tracker, for warm restarts (state.h).
+     *   samples : total samples ever pushed
+     *   ewma[i] : merged EWMAs, as in TrendSnapshot
+     *   window  : the newest `nwindow` samples, oldest first; samples from
+     *             different shards are interleaved, newest with newest
+     * The one-second rate buckets are wall-clock bound and not included.
+     */
+    typedef struct {
+        long   samples;
+        double ewma[TREND_EWMA_COUNT];
+        int    window[TREND_WINDOW_SIZE];
+        int    nwindow;
+    } TrendState;
+
     /**
      * Initialize a LearningTrendTracker.
-     * - Allocates the circular buffer (size = TREND_WINDOW_SIZE, set in config.h).
-     * - Zeros indices/counters and initializes the mutex.
+     * - Per-shard circular buffers hold TREND_WINDOW_SIZE samples (config.h).
+     * - Zeros indices/counters and initializes the mutex/cond.
      */
     void init_trend_tracker(LearningTrendTracker *tracker);
 
@@ -30,27 +64,67 @@ extern "C" {
     void destroy_trend_tracker(LearningTrendTracker *tracker);
 
     /**
-     * Push a new lrnval sample into the tracker and update the cached moving average.trend.h
-     * Thread-safe: locks tracker->mutex internally.
+     * Push a new lrnval sample into the calling thread's shard (O(1)).
+     * Every TUNER_SIGNAL_EVERY of its own samples the caller merges the
+     * shards, republishes the moving average and checks the coarse trend;
+     * waiters in wait_trend_event() are woken on a flip, or about every
+     * TUNER_SIGNAL_EVERY samples over all writers.
+     * Thread-safe and lock-free except for the wakeup itself.
      */
     void update_trend_tracker(LearningTrendTracker *tracker, int lrnval);
 
     /**
-     * Read the current moving average (double). If there are no samples yet,
-     * returns 0.0. Thread-safe.
+     * Block until the tracker posts a tuner event (see update_trend_tracker)
+     * or shutdown_trend_tracker() is called.
+     *
+     * Returns 0 on an event, -1 once the tracker is shut down.
+     */
+    int wait_trend_event(LearningTrendTracker *tracker);
+
+    /**
+     * Release all current and future waiters in wait_trend_event().
+     * Call before joining the tuner thread.
+     */
+    void shutdown_trend_tracker(LearningTrendTracker *tracker);
+
+    /**
+     * Read the moving average as of the last checkpoint (double). If there
+     * are no samples yet, returns 0.0. Thread-safe: a single atomic load.
      */
     double get_moving_average(const LearningTrendTracker *tracker);
 
     /**
-     * Provide a coarse trend signal based on the moving average and recent samples.
+     * Fill `out` with the merged EWMAs and time-window statistics.
+     * Thread-safe: lock-free reads of the shards.
+     */
+    void get_trend_snapshot(const LearningTrendTracker *tracker, TrendSnapshot *out);
+
+    /**
+     * Export the tracker's merged state into `out`. Thread-safe (lock-free
+     * reads); meant for shutdown, when writers have stopped.
+     */
+    void get_trend_state(const LearningTrendTracker *tracker, TrendState *out);
+
+    /**
+     * Seed a freshly initialized tracker with `in`: it lands in shard 0,
+     * which the first writer thread picks up, so the EWMAs and the window
+     * continue where the previous run left off. Call before any writer
+     * starts.
+     */
+    void restore_trend_state(LearningTrendTracker *tracker, const TrendState *in);
+
+    /**
+     * Provide a coarse trend signal. Once enough samples have arrived to warm
+     * the second EWMA, compares the fastest EWMA against the second one;
+     * before that, compares the recent half-window against the prior half.
      *
      * Return value convention:
      *   +1 : improving trend
      *    0 : flat/indeterminate
      *   -1 : declining trend
      *
-     * Exact heuristic is implemented in trend.c.
-     * Thread-safe.
+     * Exact heuristic (thresholds) is implemented in trend.c.
+     * Thread-safe: merges shard sums without locking.
      */
     int analyze_learning_trend(const LearningTrendTracker *tracker);
 
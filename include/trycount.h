@@ -0,0 +1,41 @@
+#ifndef AMOEBA_TRYCOUNT_H
+#define AMOEBA_TRYCOUNT_H
+
+/*
+ * trycount.h — compact try counters for (token, position) pairs
+ *
+ * How often two tokens were executed together at given positions, in a
+ * fixed array of saturating 16-bit counters indexed by a hash of
+ * (i, pi, k, pk). There is no key storage: colliding pairs share a
+ * counter, which can only make a pair look more tried than it is.
+ * Memory is fixed at EXPLORE_PAIR_SLOTS * 2 bytes whatever the vocabulary.
+ *
+ * Thread-safety: none; Words keeps it under words->mutex.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+    #endif
+
+    typedef struct {
+        unsigned short *slot;   /* mask + 1 counters; NULL = disabled (all reads 0) */
+        size_t          mask;
+    } TryCount;
+
+    /* slots_hint 0 -> EXPLORE_PAIR_SLOTS (rounded up to a power of two). */
+    int  trycount_init(TryCount *t, size_t slots_hint);
+    void trycount_free(TryCount *t);
+
+    /* Count one execution with token i at position pi and k at pk. */
+    void     trycount_note(TryCount *t, int i, int pi, int k, int pk);
+    unsigned trycount_get(const TryCount *t, int i, int pi, int k, int pk);
+
+    size_t   trycount_bytes(const TryCount *t);
+
+    #ifdef __cplusplus
+}
+#endif
+
+#endif /* AMOEBA_TRYCOUNT_H */
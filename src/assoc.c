@@ -1,8 +1,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include "config.h"
+#include "memacct.h"
 #include "assoc.h"
 
+#define BLOOM_BLOCK_WORDS 8   /* 512-bit blocks: one cache line per probe */
+
 static size_t round_up_pow2(size_t x) {
     size_t p = 1; while (p < x) p <<= 1; return p ? p : 1;
 }
@@ -23,6 +27,59 @@ static size_t hkey(int i, int pi, int k, int pk) {
     return (size_t)x;
 }
 
+/* ---- blocked Bloom filter ---- */
+
+/* Block from the high half of h, ASSOC_BLOOM_K bit positions (9 bits
+* each) from a remix, so all probes of a key stay in one cache line. */
+static void bloom_locate(const Assoc *a, uint64_t h, unsigned long long **block, uint64_t *g) {
+    size_t b = (size_t)(((h >> 32) * (uint64_t)a->bloom_blocks) >> 32);
+    *block = a->bloom + b * BLOOM_BLOCK_WORDS;
+    *g = mix64(h);
+}
+
+static void bloom_set(Assoc *a, uint64_t h) {
+    if (!a->bloom) return;
+    unsigned long long *blk;
+    uint64_t g;
+    bloom_locate(a, h, &blk, &g);
+    for (int j = 0; j < ASSOC_BLOOM_K; ++j, g >>= 9) {
+        unsigned bit = (unsigned)(g & 511);
+        blk[bit >> 6] |= 1ULL << (bit & 63);
+    }
+}
+
+static int bloom_test(const Assoc *a, uint64_t h) {
+    if (!a->bloom || !a->use_bloom) return 1;
+    unsigned long long *blk;
+    uint64_t g;
+    bloom_locate(a, h, &blk, &g);
+    for (int j = 0; j < ASSOC_BLOOM_K; ++j, g >>= 9) {
+        unsigned bit = (unsigned)(g & 511);
+        if (!(blk[bit >> 6] & (1ULL << (bit & 63)))) return 0;
+    }
+    return 1;
+}
+
+/* Size for the current bucket count (the table resizes at 3/4 load) and
+* re-add every live key. On OOM the filter is dropped (all lookups probe). */
+static void bloom_rebuild(Assoc *a) {
+    memacct_add(MEM_ASSOC_INDEX, -(long)assoc_bloom_bytes(a));
+    free(a->bloom);
+    a->bloom = NULL;
+    a->bloom_stale = 0;
+    if (!ASSOC_BLOOM) return;
+    size_t bits = a->nbuckets * ASSOC_BLOOM_BITS_PER_KEY;
+    a->bloom_blocks = bits / 512 + 1;
+    a->bloom = (unsigned long long *)calloc(a->bloom_blocks * BLOOM_BLOCK_WORDS, sizeof(*a->bloom));
+    if (!a->bloom) return;
+    memacct_add(MEM_ASSOC_INDEX, (long)assoc_bloom_bytes(a));
+    for (size_t b = 0; b < a->nbuckets; ++b) {
+        for (AssocEntry *e = a->buckets[b]; e; e = e->next) {
+            bloom_set(a, hkey(e->i, e->pi, e->k, e->pk));
+        }
+    }
+}
+
 static int keys_equal(const AssocEntry *e, int i, int pi, int k, int pk) {
     return e->i==i && e->pi==pi && e->k==k && e->pk==pk;
 }
@@ -40,9 +97,11 @@ static int resize(Assoc *a, size_t newcap) {
             e = next;
         }
     }
+    memacct_add(MEM_ASSOC_INDEX, (long)((newcap - a->nbuckets) * sizeof(*nb)));
     free(a->buckets);
     a->buckets = nb;
     a->nbuckets = newcap;
+    bloom_rebuild(a);
     return 0;
 }
 
@@ -51,8 +110,12 @@ int assoc_init(Assoc *a, size_t nbuckets_hint) {
     size_t cap = round_up_pow2(nbuckets_hint ? nbuckets_hint : 1024);
     a->buckets = (AssocEntry**)calloc(cap, sizeof(*a->buckets));
     if (!a->buckets) return -1;
+    memacct_add(MEM_ASSOC_INDEX, (long)(cap * sizeof(*a->buckets)));
     a->nbuckets = cap;
     a->nentries = 0;
+    a->bloom = NULL;
+    a->use_bloom = 1;
+    bloom_rebuild(a);
     return 0;
 }
 
@@ -62,8 +125,12 @@ void assoc_free(Assoc *a) {
         AssocEntry *e = a->buckets[b];
         while (e) { AssocEntry *n = e->next; free(e); e = n; }
     }
+    memacct_add(MEM_ASSOC_ENTRIES, -(long)(a->nentries * sizeof(AssocEntry)));
+    memacct_add(MEM_ASSOC_INDEX, -(long)(a->nbuckets * sizeof(*a->buckets) + assoc_bloom_bytes(a)));
     free(a->buckets);
+    free(a->bloom);
     a->buckets = NULL; a->nbuckets = 0; a->nentries = 0;
+    a->bloom = NULL; a->bloom_blocks = 0; a->bloom_stale = 0;
 }
 
 int assoc_add(Assoc *a, int i, int pi, int k, int pk, int delta) {
@@ -73,7 +140,8 @@ int assoc_add(Assoc *a, int i, int pi, int k, int pk, int delta) {
     if ((a->nentries + 1) * 4 > a->nbuckets * 3) {
         if (resize(a, a->nbuckets ? a->nbuckets * 2 : 1024) != 0) return -1;
     }
-    size_t idx = hkey(i,pi,k,pk) & (a->nbuckets - 1);
+    size_t h = hkey(i,pi,k,pk);
+    size_t idx = h & (a->nbuckets - 1);
     AssocEntry *e = a->buckets[idx], *prev = NULL;
     while (e) {
         if (keys_equal(e, i,pi,k,pk)) {
@@ -82,6 +150,9 @@ int assoc_add(Assoc *a, int i, int pi, int k, int pk, int delta) {
                 /* delete */
                 if (prev) prev->next = e->next; else a->buckets[idx] = e->next;
                 free(e); a->nentries--;
+                memacct_add(MEM_ASSOC_ENTRIES, -(long)sizeof(AssocEntry));
+                /* deleted keys still hit the filter; rebuild once too many went stale */
+                if (++a->bloom_stale * ASSOC_BLOOM_STALE_DIV > a->nentries + 64) bloom_rebuild(a);
             }
             return 0;
         }
@@ -90,16 +161,20 @@ int assoc_add(Assoc *a, int i, int pi, int k, int pk, int delta) {
     /* create new entry if nonzero */
     AssocEntry *ne = (AssocEntry*)malloc(sizeof(*ne));
     if (!ne) return -1;
+    memacct_add(MEM_ASSOC_ENTRIES, (long)sizeof(*ne));
     ne->i=i; ne->pi=pi; ne->k=k; ne->pk=pk; ne->val=delta;
     ne->next = a->buckets[idx];
     a->buckets[idx] = ne;
     a->nentries++;
+    bloom_set(a, h);
     return 0;
 }
 
 int assoc_get(const Assoc *a, int i, int pi, int k, int pk) {
     if (!a || !a->buckets) return 0;
-    size_t idx = hkey(i,pi,k,pk) & (a->nbuckets - 1);
+    size_t h = hkey(i,pi,k,pk);
+    if (!bloom_test(a, h)) return 0; /* sparse graph: most probes end here */
+    size_t idx = h & (a->nbuckets - 1);
     AssocEntry *e = a->buckets[idx];
     while (e) {
         if (keys_equal(e, i,pi,k,pk)) return e->val;
@@ -108,6 +183,15 @@ int assoc_get(const Assoc *a, int i, int pi, int k, int pk) {
     return 0;
 }
 
+int assoc_maybe_contains(const Assoc *a, int i, int pi, int k, int pk) {
+    if (!a || !a->buckets) return 0;
+    return bloom_test(a, hkey(i,pi,k,pk));
+}
+
+size_t assoc_bloom_bytes(const Assoc *a) {
+    return (a && a->bloom) ? a->bloom_blocks * BLOOM_BLOCK_WORDS * sizeof(*a->bloom) : 0;
+}
+
 int assoc_iter_next(AssocIter *it, int *i, int *pi, int *k, int *pk, int *val) {
     if (!it || !it->a || !it->a->buckets) return 0;
     if (it->e) {
@@ -115,7 +199,7 @@ int assoc_iter_next(AssocIter *it, int *i, int *pi, int *k, int *pk, int *val) {
         if (it->e) goto have;
         it->bucket++;
     }
-    while (it->bucket < it->a->nbuckets) {
+    while (it->bucket < it->end) {
         it->e = it->a->buckets[it->bucket];
         if (it->e) goto have;
         it->bucket++;
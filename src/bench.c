@@ -0,0 +1,439 @@
+// src/bench.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "split.h"
+#include "toktab.h"
+#include "assoc.h"
+#include "model.h"
+#include "database.h"
+#include "command.h"
+#include "dump.h"
+#include "trace.h"
+#include "bench.h"
+
+/* =========================
+* Internal helpers
+* ========================= */
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Deterministic xorshift so runs are comparable. */
+static unsigned long bench_rand(unsigned long *s) {
+    *s ^= *s << 13; *s ^= *s >> 7; *s ^= *s << 17;
+    return *s;
+}
+
+/* Text shaped like command output: words of 1..16 bytes separated by
+* mostly single spaces, with newlines, tabs and the odd run of blanks. */
+static char *make_text(size_t len) {
+    static const char seps[] = "         \n\n\t\r";
+    char *buf = (char *)malloc(len + 1);
+    if (!buf) return NULL;
+    unsigned long seed = 0x9e3779b97f4a7c15UL;
+    size_t i = 0;
+    while (i < len) {
+        size_t w = 1 + bench_rand(&seed) % 16;
+        for (size_t k = 0; k < w && i < len; ++k) buf[i++] = (char)('a' + bench_rand(&seed) % 26);
+        size_t gap = (bench_rand(&seed) % 8 == 0) ? 2 + bench_rand(&seed) % 6 : 1;
+        for (size_t k = 0; k < gap && i < len; ++k) buf[i++] = seps[bench_rand(&seed) % (sizeof(seps) - 1)];
+    }
+    buf[len] = '\0';
+    return buf;
+}
+
+static int count_span(const char *tok, size_t len, void *ctx) {
+    (void)tok;
+    *(size_t *)ctx += len;
+    return 0;
+}
+
+static size_t split_strtok(char *work, const char *src, size_t len, size_t *bytes) {
+    memcpy(work, src, len + 1);
+    size_t n = 0;
+    char *save = NULL;
+    for (char *t = strtok_r(work, " \t\r\n", &save); t; t = strtok_r(NULL, " \t\r\n", &save)) {
+        *bytes += strlen(t);
+        n++;
+    }
+    return n;
+}
+
+static int bench_split(FILE *fp) {
+    const size_t len = (size_t)BENCH_SPLIT_MB * 1024 * 1024;
+    char *text = make_text(len);
+    char *work = (char *)malloc(len + 1);
+    if (!text || !work) { free(text); free(work); return -1; }
+
+    fprintf(fp, "[bench] whitespace split: %d MiB x %d rep(s), active impl: %s\n",
+            BENCH_SPLIT_MB, BENCH_REPS, split_impl_name(split_active_impl()));
+
+    size_t ref_tokens = 0, ref_bytes = 0;
+    double t0 = now_s();
+    for (int r = 0; r < BENCH_REPS; ++r) {
+        ref_bytes = 0;
+        ref_tokens = split_strtok(work, text, len, &ref_bytes);
+    }
+    double dt = now_s() - t0;
+    fprintf(fp, "  %-8s %8.2f GB/s  %zu token(s)  (copy + strtok_r baseline)\n",
+            "strtok", (double)len * BENCH_REPS / dt / 1e9, ref_tokens);
+
+    int rc = 0;
+    for (int k = 0; k < SPLIT_IMPLS; ++k) {
+        if (!split_impl_available((SplitImpl)k)) {
+            fprintf(fp, "  %-8s unavailable\n", split_impl_name((SplitImpl)k));
+            continue;
+        }
+        size_t n = 0, bytes = 0;
+        t0 = now_s();
+        for (int r = 0; r < BENCH_REPS; ++r) {
+            bytes = 0;
+            n = split_whitespace_with((SplitImpl)k, text, len, count_span, &bytes);
+        }
+        dt = now_s() - t0;
+        int ok = (n == ref_tokens && bytes == ref_bytes);
+        fprintf(fp, "  %-8s %8.2f GB/s  %zu token(s)%s\n", split_impl_name((SplitImpl)k),
+                (double)len * BENCH_REPS / dt / 1e9, n, ok ? "" : "  MISMATCH");
+        if (!ok) rc = -1;
+    }
+    free(text);
+    free(work);
+    return rc;
+}
+
+/* ---- token lookup: lock-free readers vs. one mutex, with a live writer ---- */
+
+typedef struct {
+    TokenTable      *tab;
+    pthread_mutex_t *lock;       /* NULL = lock-free lookups */
+    char           (*names)[16];
+    size_t           nnames;
+    unsigned long    seed;
+    unsigned long    found;
+} LookupArgs;
+
+typedef struct {
+    TokenTable      *tab;
+    pthread_mutex_t *lock;       /* writer always serializes on it */
+    _Atomic int     *stop;
+    int              next_id;
+} WriterArgs;
+
+static void *lookup_worker(void *arg) {
+    LookupArgs *a = (LookupArgs *)arg;
+    for (long i = 0; i < BENCH_LOOKUPS; ++i) {
+        const char *nm = a->names[bench_rand(&a->seed) % a->nnames];
+        size_t n = strlen(nm);
+        if (a->lock) pthread_mutex_lock(a->lock);
+        if (toktab_lookup(a->tab, nm, n)) a->found++;
+        if (a->lock) pthread_mutex_unlock(a->lock);
+    }
+    return NULL;
+}
+
+static void *insert_worker(void *arg) {
+    WriterArgs *w = (WriterArgs *)arg;
+    char buf[32];
+    while (!atomic_load(w->stop)) {
+        int n = snprintf(buf, sizeof(buf), "new%d", w->next_id);
+        pthread_mutex_lock(w->lock);
+        (void)toktab_insert(w->tab, buf, (size_t)n, w->next_id++);
+        pthread_mutex_unlock(w->lock);
+        struct timespec ts = {0, 100 * 1000}; /* ~10k inserts/s */
+        nanosleep(&ts, NULL);
+    }
+    return NULL;
+}
+
+static double run_lookups(TokenTable *tab, pthread_mutex_t *lock, int use_lock,
+                          char (*names)[16], size_t nnames, int nthreads) {
+    pthread_t tids[BENCH_MAX_THREADS], wtid;
+    LookupArgs args[BENCH_MAX_THREADS];
+    _Atomic int stop = 0;
+    WriterArgs wa = { tab, lock, &stop, 1 << 20 };
+    if (pthread_create(&wtid, NULL, insert_worker, &wa) != 0) return 0.0;
+
+    double t0 = now_s();
+    int started = 0;
+    for (int i = 0; i < nthreads; ++i) {
+        args[i] = (LookupArgs){ tab, use_lock ? lock : NULL, names, nnames, 0x2545f4914f6cdd1dUL + (unsigned long)i, 0 };
+        if (pthread_create(&tids[i], NULL, lookup_worker, &args[i]) != 0) break;
+        started++;
+    }
+    for (int i = 0; i < started; ++i) pthread_join(tids[i], NULL);
+    double dt = now_s() - t0;
+    atomic_store(&stop, 1);
+    pthread_join(wtid, NULL);
+    return dt > 0.0 ? (double)started * BENCH_LOOKUPS / dt / 1e6 : 0.0;
+}
+
+static int bench_lookup(FILE *fp) {
+    const size_t nnames = 2 * BENCH_VOCAB;
+    char (*names)[16] = malloc(nnames * sizeof(*names));
+    if (!names) return -1;
+    TokenTable tab;
+    if (toktab_init(&tab, 0) != 0) { free(names); return -1; }
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+    /* half of the probed names are in the table, half are misses */
+    for (size_t i = 0; i < nnames; ++i) {
+        int n = snprintf(names[i], sizeof(names[i]), "tok%zu", i);
+        if (i < BENCH_VOCAB) (void)toktab_insert(&tab, names[i], (size_t)n, (int)i);
+    }
+
+    fprintf(fp, "[bench] token lookup: %d-token table, %d lookups/thread, concurrent inserter\n",
+            BENCH_VOCAB, BENCH_LOOKUPS);
+    fprintf(fp, "  %-8s %14s %14s\n", "threads", "lock-free M/s", "mutex M/s");
+    for (int n = 1; n <= BENCH_MAX_THREADS; n *= 2) {
+        double lf = run_lookups(&tab, &lock, 0, names, nnames, n);
+        double mx = run_lookups(&tab, &lock, 1, names, nnames, n);
+        fprintf(fp, "  %-8d %14.1f %14.1f\n", n, lf, mx);
+    }
+    toktab_free(&tab);
+    pthread_mutex_destroy(&lock);
+    free(names);
+    return 0;
+}
+
+/* ---- assoc_get: Bloom filter in front of the chain walk ---- */
+
+/* Keys look like the learner's: token pairs at positions < CMDMAX. */
+static void rand_key(unsigned long *seed, int *i, int *pi, int *k, int *pk) {
+    *i  = (int)(bench_rand(seed) % 4000);
+    *pi = (int)(bench_rand(seed) % CMDMAX);
+    *k  = (int)(bench_rand(seed) % 4000);
+    *pk = (int)(bench_rand(seed) % CMDMAX);
+}
+
+static double time_probes(Assoc *a, unsigned long seed, long *sink) {
+    long acc = 0;
+    double t0 = now_s();
+    for (long n = 0; n < BENCH_ASSOC_PROBES; ++n) {
+        int i, pi, k, pk;
+        rand_key(&seed, &i, &pi, &k, &pk);
+        acc += assoc_get(a, i, pi, k, pk);
+    }
+    double dt = now_s() - t0;
+    *sink += acc;
+    return dt;
+}
+
+static int bench_assoc(FILE *fp) {
+    Assoc a;
+    if (assoc_init(&a, 0) != 0) return -1;
+    unsigned long seed = 0x853c49e6748fea9bUL;
+    for (long n = 0; n < BENCH_ASSOC_KEYS; ++n) {
+        int i, pi, k, pk;
+        rand_key(&seed, &i, &pi, &k, &pk);
+        (void)assoc_add(&a, i, pi, k, pk, 1 + (int)(bench_rand(&seed) % 10));
+    }
+    /* prune a quarter back to zero, as penalties do */
+    seed = 0x853c49e6748fea9bUL;
+    for (long n = 0; n < BENCH_ASSOC_KEYS / 4; ++n) {
+        int i, pi, k, pk;
+        rand_key(&seed, &i, &pi, &k, &pk);
+        int v = assoc_get(&a, i, pi, k, pk);
+        (void)bench_rand(&seed);
+        if (v) (void)assoc_add(&a, i, pi, k, pk, -v);
+    }
+
+    /* filter quality: probes the filter let through that then missed */
+    unsigned long pseed = 0xda3e39cb94b95bdbUL;
+    unsigned long passed = 0, present = 0, rejected = 0;
+    for (long n = 0; n < BENCH_ASSOC_PROBES; ++n) {
+        int i, pi, k, pk;
+        rand_key(&pseed, &i, &pi, &k, &pk);
+        int maybe = assoc_maybe_contains(&a, i, pi, k, pk);
+        int hit = assoc_get(&a, i, pi, k, pk) != 0;
+        present += (unsigned long)hit;
+        if (!maybe) rejected++;
+        else if (!hit) passed++;
+    }
+    unsigned long absent = (unsigned long)BENCH_ASSOC_PROBES - present;
+
+    long sink = 0;
+    double with = time_probes(&a, 0xda3e39cb94b95bdbUL, &sink);
+    a.use_bloom = 0;
+    double without = time_probes(&a, 0xda3e39cb94b95bdbUL, &sink);
+    a.use_bloom = 1;
+
+    fprintf(fp, "[bench] assoc_get: %zu live key(s) in %zu bucket(s), filter %.1f KiB, %d probes\n",
+            a.nentries, a.nbuckets, (double)assoc_bloom_bytes(&a) / 1024.0, BENCH_ASSOC_PROBES);
+    fprintf(fp, "  hits %.2f%%, chain walks saved %.2f%%, false positive rate %.3f%%\n",
+            100.0 * (double)present / BENCH_ASSOC_PROBES,
+            100.0 * (double)rejected / BENCH_ASSOC_PROBES,
+            absent ? 100.0 * (double)passed / (double)absent : 0.0);
+    fprintf(fp, "  %6.1f ns/get with filter, %6.1f ns/get without (checksum %ld)\n",
+            with * 1e9 / BENCH_ASSOC_PROBES, without * 1e9 / BENCH_ASSOC_PROBES, sink);
+    assoc_free(&a);
+    return 0;
+}
+
+/* ---- write_database: chunked parallel formatting vs. one fprintf loop ---- */
+
+/* The old single-threaded assoc dump, as the baseline. */
+static size_t fprintf_assoc(const Assoc *a, FILE *out) {
+    AssocIter it;
+    assoc_iter_init(a, &it);
+    int i, pi, k, pk, v;
+    size_t rows = 0;
+    while (assoc_iter_next(&it, &i, &pi, &k, &pk, &v)) {
+        fprintf(out, "%d\t%d\t%d\t%d\t%d\n", i, pi, k, pk, v);
+        ++rows;
+    }
+    return rows;
+}
+
+static int bench_persist(FILE *fp) {
+    Words w;
+    Observations o;
+    init_words(&w);
+    init_observations(&o);
+    unsigned long seed = 0x510e527fade682d1UL;
+    for (long n = 0; n < BENCH_PERSIST_ROWS; ++n) {
+        int i, pi, k, pk;
+        rand_key(&seed, &i, &pi, &k, &pk);
+        (void)assoc_add(&w.assoc, i * 16 + pi, pi, k, pk, 1 + (int)(bench_rand(&seed) % 100));
+    }
+    size_t nobs = BENCH_PERSIST_ROWS / 4;
+    for (size_t n = 0; n < nobs; ++n) {
+        int *row = (int *)malloc(13 * sizeof(int));
+        if (!row) break;
+        for (int j = 0; j < 12; ++j) row[j] = (int)(bench_rand(&seed) % 50000) - 5;
+        row[12] = IDX_TERMINATOR;
+        if (append_observation(&o, row) != 0) { free(row); break; }
+    }
+
+    FILE *null = fopen("/dev/null", "w");
+    if (!null) { cleanup_database(&w, &o); return -1; }
+    fprintf(fp, "[bench] write_database: %zu assoc row(s) + %zu observation(s) to /dev/null, %d rep(s)\n",
+            w.assoc.nentries, o.numObservations, BENCH_REPS);
+    double t0 = now_s();
+    for (int r = 0; r < BENCH_REPS; ++r) (void)fprintf_assoc(&w.assoc, null);
+    double base = (now_s() - t0) / BENCH_REPS;
+    fprintf(fp, "  %-10s %8.1f ms  (assoc only, fprintf per row)\n", "baseline", base * 1e3);
+
+    /* the [persist] log lines go to stdout; keep them out of the report */
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    for (int n = 1; n <= BENCH_MAX_THREADS && n <= MAX_THREADS; n *= 2) {
+        dump_set_threads(n);
+        if (saved >= 0) dup2(fileno(null), STDOUT_FILENO);
+        t0 = now_s();
+        for (int r = 0; r < BENCH_REPS; ++r) write_database(&w, &o, NULL, "/dev/null", "/dev/null");
+        double dt = (now_s() - t0) / BENCH_REPS;
+        fflush(stdout);
+        if (saved >= 0) dup2(saved, STDOUT_FILENO);
+        fprintf(fp, "  %d thread(s) %8.1f ms  (assoc + observations)\n", n, dt * 1e3);
+        fflush(fp);
+    }
+    if (saved >= 0) close(saved);
+    dump_set_threads(0);
+    fclose(null);
+    cleanup_database(&w, &o);
+    return 0;
+}
+
+/* ---- trace span cost (enabled vs. disabled) ---- */
+
+static int bench_trace(FILE *fp) {
+    const long spans = 2000000;
+    double t0 = now_s();
+    for (long i = 0; i < spans; ++i) trace_end(TRACE_GENERATE, trace_begin());
+    double off = now_s() - t0;
+    trace_enable("/dev/null");
+    t0 = now_s();
+    for (long i = 0; i < spans; ++i) trace_end(TRACE_GENERATE, trace_begin());
+    double on = now_s() - t0;
+    trace_free();
+    fprintf(fp, "[bench] trace span: %.1f ns recorded, %.1f ns with tracing off (%ld spans)\n",
+            on * 1e9 / (double)spans, off * 1e9 / (double)spans, spans);
+    return 0;
+}
+
+/* ---- construct_command latency vs. vocabulary size ---- */
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void construct_percentiles(Words *w, CommandSettings *cs, int budget_us,
+                                  double *p50, double *p99) {
+    double lat[BENCH_CONSTRUCT_CALLS];
+    int cmd[CMDMAX + 1];
+    IntBuf scratch = {0};
+    cs->budget_us = budget_us;
+    for (int n = 0; n < BENCH_CONSTRUCT_CALLS; ++n) {
+        double t0 = now_s();
+        (void)construct_command(w, cs, cmd, &scratch);
+        lat[n] = (now_s() - t0) * 1e6;
+    }
+    intbuf_free(&scratch);
+    qsort(lat, BENCH_CONSTRUCT_CALLS, sizeof(lat[0]), cmp_double);
+    *p50 = lat[BENCH_CONSTRUCT_CALLS / 2];
+    *p99 = lat[(BENCH_CONSTRUCT_CALLS * 99) / 100];
+}
+
+static int bench_construct(FILE *fp) {
+    static const int sizes[] = { 1000, 10000, 100000 };
+    fprintf(fp, "[bench] construct_command: length 4, scope %d%%, %d call(s) per row (us)\n",
+            BENCH_CONSTRUCT_SCOPE, BENCH_CONSTRUCT_CALLS);
+    fprintf(fp, "  %-8s %10s %10s %10s %10s\n", "vocab", "full p50", "full p99", "any p50", "any p99");
+    for (size_t si = 0; si < sizeof(sizes) / sizeof(sizes[0]); ++si) {
+        Words w;
+        init_words(&w);
+        char name[32];
+        unsigned long seed = 0x6a09e667f3bcc909UL;
+        for (int i = 0; i < sizes[si]; ++i) {
+            snprintf(name, sizeof(name), "w%d", i);
+            (void)add_word(&w, name);
+        }
+        /* a sparse association graph, a few edges per token */
+        for (int i = 0; i < sizes[si] * 4; ++i) {
+            int a = (int)(bench_rand(&seed) % (unsigned long)sizes[si]);
+            int b = (int)(bench_rand(&seed) % (unsigned long)sizes[si]);
+            (void)assoc_add(&w.assoc, a, (int)(bench_rand(&seed) % 4), b, (int)(bench_rand(&seed) % 4), 1);
+        }
+
+        CommandSettings cs;
+        cs.length = 4;
+        cs.scope = BENCH_CONSTRUCT_SCOPE;
+        cs.explore = EXPLORE_UCB_C;
+        pthread_mutex_init(&cs.mutex, NULL);
+        double f50, f99, a50, a99;
+        construct_percentiles(&w, &cs, 0, &f50, &f99);
+        construct_percentiles(&w, &cs, CONSTRUCT_BUDGET_US, &a50, &a99);
+        fprintf(fp, "  %-8d %10.1f %10.1f %10.1f %10.1f\n", sizes[si], f50, f99, a50, a99);
+        pthread_mutex_destroy(&cs.mutex);
+        cleanup_database(&w, NULL);
+    }
+    return 0;
+}
+
+/* =========================
+* Public API
+* ========================= */
+
+int run_benchmarks(FILE *fp) {
+    if (!fp) return -1;
+    int rc = 0;
+    if (bench_split(fp) != 0) rc = -1;
+    if (bench_lookup(fp) != 0) rc = -1;
+    if (bench_assoc(fp) != 0) rc = -1;
+    if (bench_construct(fp) != 0) rc = -1;
+    if (bench_persist(fp) != 0) rc = -1;
+    if (bench_trace(fp) != 0) rc = -1;
+    fflush(fp);
+    return rc;
+}
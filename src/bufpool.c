@@ -0,0 +1,84 @@
+// src/bufpool.c
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "config.h"
+#include "memacct.h"
+#include "bufpool.h"
+
+static _Atomic unsigned long g_grows;
+
+/* =========================
+* Internal helpers
+* ========================= */
+
+static int grow(void **data, size_t *cap, size_t need, size_t elem) {
+    if (need <= *cap) return 0;
+    size_t ncap = *cap ? *cap : BUFPOOL_MIN_BYTES / elem;
+    while (ncap < need) ncap *= 2;
+    void *p = realloc(*data, ncap * elem);
+    if (!p) return -1;
+    *data = p;
+    memacct_add(MEM_BUFFERS, (long)((ncap - *cap) * elem));
+    *cap = ncap;
+    atomic_fetch_add_explicit(&g_grows, 1, memory_order_relaxed);
+    return 0;
+}
+
+/* =========================
+* Public API
+* ========================= */
+
+int bytebuf_reserve(ByteBuf *b, size_t need) {
+    if (!b) return -1;
+    void *d = b->data;
+    int rc = grow(&d, &b->cap, need, sizeof(*b->data));
+    b->data = (char *)d;
+    return rc;
+}
+
+int intbuf_reserve(IntBuf *b, size_t need) {
+    if (!b) return -1;
+    void *d = b->data;
+    int rc = grow(&d, &b->cap, need, sizeof(*b->data));
+    b->data = (int *)d;
+    return rc;
+}
+
+void bytebuf_free(ByteBuf *b) {
+    if (!b) return;
+    memacct_add(MEM_BUFFERS, -(long)b->cap);
+    free(b->data);
+    memset(b, 0, sizeof(*b));
+}
+
+void intbuf_free(IntBuf *b) {
+    if (!b) return;
+    memacct_add(MEM_BUFFERS, -(long)(b->cap * sizeof(*b->data)));
+    free(b->data);
+    memset(b, 0, sizeof(*b));
+}
+
+void worker_buffers_init(WorkerBuffers *wb) {
+    if (wb) memset(wb, 0, sizeof(*wb));
+}
+
+void worker_buffers_free(WorkerBuffers *wb) {
+    if (!wb) return;
+    bytebuf_free(&wb->out);
+    bytebuf_free(&wb->cmd);
+    bytebuf_free(&wb->args);
+    intbuf_free(&wb->idx);
+    intbuf_free(&wb->cands);
+}
+
+size_t worker_buffers_bytes(const WorkerBuffers *wb) {
+    if (!wb) return 0;
+    return wb->out.cap + wb->cmd.cap + wb->args.cap
+         + (wb->idx.cap + wb->cands.cap) * sizeof(int);
+}
+
+unsigned long bufpool_grows(void) {
+    return atomic_load_explicit(&g_grows, memory_order_relaxed);
+}
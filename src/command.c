@@ -4,12 +4,15 @@
 #include <string.h>
 #include <time.h>
 #include <stdint.h>   // uintptr_t
-#include <limits.h>   // LONG_MIN
+#include <math.h>     // sqrt, log
+#include <stdatomic.h>
 
 #include "config.h"
 #include "model.h"
 #include "command.h"
 #include "assoc.h"
+#include "exestats.h"
+#include "trace.h"
 
 /* =========================
 * RNG helpers
@@ -38,6 +41,53 @@ static void partial_shuffle(int *arr, int n, int k) {
     }
 }
 
+static double now_monotonic_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* =========================
+* Latency histogram
+* =========================
+* Nanoseconds in log2 buckets split into LAT_SUB steps (<= 19% error).
+*/
+
+#define LAT_SUB     4
+#define LAT_BUCKETS (64 * LAT_SUB)
+
+static _Atomic unsigned long g_lat[LAT_BUCKETS];
+
+static int lat_bucket(uint64_t ns) {
+    if (ns < LAT_SUB) return (int)ns;
+    int e = 63 - __builtin_clzll(ns);
+    return e * LAT_SUB + (int)((ns >> (e - 2)) & (LAT_SUB - 1));
+}
+
+/* midpoint of bucket b, in nanoseconds */
+static double lat_value(int b) {
+    if (b < LAT_SUB) return (double)b;
+    int e = b / LAT_SUB, sub = b % LAT_SUB;
+    double lo = (double)((uint64_t)(LAT_SUB + sub) << (e - 2));
+    return lo + (double)(1ULL << (e - 2)) / 2.0;
+}
+
+static void note_latency(double seconds) {
+    uint64_t ns = seconds > 0.0 ? (uint64_t)(seconds * 1e9) : 0;
+    atomic_fetch_add_explicit(&g_lat[lat_bucket(ns)], 1, memory_order_relaxed);
+}
+
+static double lat_percentile(const unsigned long *hist, unsigned long n, double q) {
+    if (n == 0) return 0.0;
+    unsigned long want = (unsigned long)((double)n * q + 0.5), seen = 0;
+    if (want < 1) want = 1;
+    for (int b = 0; b < LAT_BUCKETS; ++b) {
+        seen += hist[b];
+        if (seen >= want) return lat_value(b) / 1000.0;
+    }
+    return lat_value(LAT_BUCKETS - 1) / 1000.0;
+}
+
 /* =========================
 * Scoring helpers (sparse)
 * ========================= */
@@ -63,20 +113,64 @@ static long pair_score(const Words *words,
     return s;
 }
 
-/* Greedy pick: at position pos, select the candidate with max pair_score.
-*   If all scores equal, pick random among them. */
-static int greedy_pick(const Words *words,
+/* UCB1 exploration, with c = 0 meaning the plain cumulative pair_score.
+*   Leader (pos 0): exestats prior + c * sqrt(ln(1 + T_0) / (1 + n_tok,0)).
+*   Later positions: mean association per joint try with each chosen token,
+*   summed, plus c * sqrt(ln(1 + n_chosen) / (1 + n_pair)) for the least
+*   tried pair. Cumulative sums would let a pair that earns +1 every time
+*   (say, empty output) outgrow every untried one; means do not. */
+typedef struct {
+    double c;
+    double log_total[CMDMAX];   /* ln(1 + pos_tries[p]), once per construction */
+    double log_chosen[CMDMAX];  /* ln(1 + tries of chosen[q] at q), filled as picked */
+} Explore;
+
+static void explore_init(const Words *words, double c, Explore *ex) {
+    ex->c = c > 0.0 ? c : 0.0;
+    for (int p = 0; p < CMDMAX; ++p) ex->log_total[p] = log(1.0 + (double)words->pos_tries[p]);
+}
+
+static void explore_chosen(const Words *words, Explore *ex, int w, int pos) {
+    if (pos < CMDMAX)
+        ex->log_chosen[pos] = log(1.0 + (double)words->meta.tries[(size_t)w * CMDMAX + (size_t)pos]);
+}
+
+static double leader_bonus(const Words *words, const Explore *ex, int w) {
+    if (ex->c <= 0.0) return 0.0;
+    double n = (double)words->meta.tries[(size_t)w * CMDMAX];
+    return ex->c * sqrt(ex->log_total[0] / (1.0 + n));
+}
+
+static double candidate_score(const Words *words, const Explore *ex,
+                              int w, int pos, const int *chosen, int chosen_cnt) {
+    if (ex->c <= 0.0) return (double)pair_score(words, w, pos, chosen, chosen_cnt);
+    double mean = 0.0, bonus = 0.0;
+    for (int q = 0; q < chosen_cnt; ++q) {
+        int wq = chosen[q];
+        if (wq < 0 || (size_t)wq >= words->numWords || (size_t)w >= words->numWords) continue;
+        unsigned n = trycount_get(&words->pair_tries, wq, q, w, pos);
+        long s = assoc_get(&words->assoc, w, pos, wq, q) + assoc_get(&words->assoc, wq, q, w, pos);
+        mean += (double)s / (double)(n ? n : 1);
+        double b = ex->c * sqrt(ex->log_chosen[q] / (1.0 + (double)n));
+        if (b > bonus) bonus = b;
+    }
+    return mean + bonus;
+}
+
+/* Greedy pick: at position pos, select the candidate with the best
+*   candidate_score. If all scores equal, pick random among them. */
+static int greedy_pick(const Words *words, const Explore *ex,
                        const int *cands, int cand_cnt,
                        const int *chosen, int chosen_cnt,
                        int pos) {
-    long best = LONG_MIN;
+    double best = 0.0;
     int best_indices[LINEBUFFER]; /* generous bound */
     int best_count = 0;
 
     for (int i = 0; i < cand_cnt; ++i) {
         int w = cands[i];
-        long s = pair_score(words, w, pos, chosen, chosen_cnt);
-        if (s > best) {
+        double s = candidate_score(words, ex, w, pos, chosen, chosen_cnt);
+        if (best_count == 0 || s > best) {
             best = s;
             best_indices[0] = i;
             best_count = 1;
@@ -95,31 +189,185 @@ static int greedy_pick(const Words *words,
     return best_indices[which];
 }
 
+/* First position: probe up to FIRST_PICK_PROBES sampled candidates and keep
+*   the one with the best per-executable prior plus novelty bonus, skipping
+*   leaders that have proven dead. Falls back to a uniform pick if every
+*   probe is dead. */
+static int first_pick(const Words *words, const Explore *ex, const int *cands, int cand_cnt) {
+    int probes = MIN(cand_cnt, FIRST_PICK_PROBES);
+    int best_i = -1;
+    double best = 0.0;
+    for (int p = 0; p < probes; ++p) {
+        int i = (probes == cand_cnt) ? p : rand_between(0, cand_cnt - 1);
+        int dead = 0;
+        double s = exestats_first_score(&words->exestats, cands[i], &dead);
+        if (dead) continue;
+        s += leader_bonus(words, ex, cands[i]);
+        if (best_i < 0 || s > best || (s == best && rand_between(0, 1))) {
+            best = s;
+            best_i = i;
+        }
+    }
+    return best_i >= 0 ? best_i : rand_between(0, cand_cnt - 1);
+}
+
+/* =========================
+* Construction strategies
+* =========================
+* Both run with words->mutex held and fill chosen[], returning argc.
+*/
+
+static int sample_size_for(size_t N, int scope_pct) {
+    int n = (int)((double)N * (double)CLAMP(scope_pct, SRCHMIN, SRCHMAX) / 100.0 + 0.5);
+    return n < 1 ? 1 : (n > (int)N ? (int)N : n);
+}
+
+/* Leading token (O(probes)): from the executable-only index when we have
+* one, so we don't fork a shell just to hear "command not found". */
+static int pick_leader(const Words *words, const Explore *ex, const int *cands, int cand_cnt) {
+    if (EXEC_ONLY_LEADERS && words->numExec > 0) {
+        return words->exec_ids[first_pick(words, ex, words->exec_ids, (int)words->numExec)];
+    }
+    if (cands) return cands[first_pick(words, ex, cands, cand_cnt)];
+    int probe[FIRST_PICK_PROBES];
+    int n = MIN(FIRST_PICK_PROBES, cand_cnt);
+    for (int i = 0; i < n; ++i) probe[i] = rand_between(0, (int)words->numWords - 1);
+    return probe[first_pick(words, ex, probe, n)];
+}
+
+/* Exhaustive: shuffle a scope-sized window of the vocabulary and score all
+* of it at every position. Cost grows linearly with the vocabulary. */
+static int construct_exhaustive(const Words *words, Explore *ex, int want_len, int scope_pct,
+                                IntBuf *scratch, int chosen[CMDMAX]) {
+    size_t N = words->numWords;
+    int sample_size = sample_size_for(N, scope_pct);
+
+    /* Build candidate index list [0..N-1] and sample 'sample_size' without replacement */
+    IntBuf local = {0};
+    IntBuf *pool = scratch ? scratch : &local;
+    int *candidates = intbuf_reserve(pool, N) == 0 ? pool->data : NULL;
+    if (!candidates) return 0;
+    for (size_t i = 0; i < N; ++i) candidates[i] = (int)i;
+
+    /* Partial shuffle to select K candidates */
+    partial_shuffle(candidates, (int)N, sample_size);
+
+    /* Greedy construction using sparse associations */
+    int argc = 0;
+    int lead = pick_leader(words, ex, candidates, sample_size);
+    explore_chosen(words, ex, lead, argc);
+    chosen[argc++] = lead;
+    for (int i = 0; i < sample_size; ++i) {
+        if (candidates[i] == lead) {
+            candidates[i] = candidates[sample_size - 1];
+            sample_size--;
+            break;
+        }
+    }
+
+    /* Continue greedy picks */
+    while (argc < want_len && sample_size > 0) {
+        int best_idx_in_cands = greedy_pick(words, ex, candidates, sample_size, chosen, argc, argc);
+        if (best_idx_in_cands < 0) {
+            /* fallback: random */
+            best_idx_in_cands = rand_between(0, sample_size - 1);
+        }
+        int w = candidates[best_idx_in_cands];
+        explore_chosen(words, ex, w, argc);
+        chosen[argc++] = w;
+
+        /* remove selected from pool */
+        candidates[best_idx_in_cands] = candidates[sample_size - 1];
+        sample_size--;
+    }
+
+    intbuf_free(&local);
+    return argc;
+}
+
+typedef struct {
+    int    best;
+    double best_score;
+    int    ties;
+    int    spent;
+} AnytimePick;
+
+static void anytime_consider(const Words *words, const Explore *ex, AnytimePick *p, int w,
+                             const int *chosen, int argc) {
+    for (int q = 0; q < argc; ++q) if (chosen[q] == w) return;
+    double s = candidate_score(words, ex, w, argc, chosen, argc);
+    p->spent++;
+    if (p->best < 0 || s > p->best_score) {
+        p->best = w; p->best_score = s; p->ties = 1;
+    } else if (s == p->best_score && rand_between(0, p->ties++) == 0) {
+        p->best = w; /* reservoir: uniform among equal scores */
+    }
+}
+
+/* Anytime: per position, score rewarded partners of the tokens chosen so
+* far first, then uniform random samples, until CONSTRUCT_BUDGET_PROBES
+* candidates (at most the scope window) were scored or the deadline
+* passed; keep the best seen. Cost is independent of vocabulary size. */
+static int construct_anytime(const Words *words, Explore *ex, int want_len, int scope_pct,
+                             double deadline, int chosen[CMDMAX]) {
+    size_t N = words->numWords;
+    int probes = MIN(CONSTRUCT_BUDGET_PROBES, sample_size_for(N, scope_pct));
+
+    int argc = 0;
+    chosen[argc] = pick_leader(words, ex, NULL, probes);
+    explore_chosen(words, ex, chosen[argc], argc);
+    argc++;
+
+    while (argc < want_len && (size_t)argc < N) {
+        AnytimePick p = { -1, 0, 0, 0 };
+
+        for (int q = argc - 1; q >= 0 && p.spent < probes; --q) {
+            const int *nb = &words->meta.nbr[(size_t)chosen[q] * NEIGHBOR_SLOTS];
+            for (int j = 0; j < NEIGHBOR_SLOTS && p.spent < probes; ++j) {
+                if (nb[j] >= 0 && (size_t)nb[j] < N) anytime_consider(words, ex, &p, nb[j], chosen, argc);
+            }
+        }
+        for (int tries = 0; p.spent < probes && tries < 2 * probes; ++tries) {
+            if (p.best >= 0 && (tries & 7) == 0 && now_monotonic_s() >= deadline) break;
+            anytime_consider(words, ex, &p, rand_between(0, (int)N - 1), chosen, argc);
+        }
+        if (p.best < 0) break;
+        explore_chosen(words, ex, p.best, argc);
+        chosen[argc++] = p.best;
+    }
+    return argc;
+}
+
 /* =========================
 * Public API
 * ========================= */
 
 int construct_command(const Words *words,
                       const CommandSettings *settings,
-                      int out_cmd[CMDMAX + 1]) {
+                      int out_cmd[CMDMAX + 1],
+                      IntBuf *scratch) {
     ensure_seeded();
 
     if (!words || !settings || !out_cmd) {
         if (out_cmd) out_cmd[0] = IDX_TERMINATOR;
         return 0;
     }
+    double t0 = now_monotonic_s();
 
     /* Snapshot settings while holding its mutex */
-    int want_len, scope_pct;
+    int want_len, scope_pct, budget_us;
+    double explore;
     pthread_mutex_lock((pthread_mutex_t*)&settings->mutex);
     want_len  = settings->length;
     scope_pct = settings->scope;
+    budget_us = settings->budget_us;
+    explore   = settings->explore;
     pthread_mutex_unlock((pthread_mutex_t*)&settings->mutex);
 
     want_len  = CLAMP(want_len,  CMDMIN, CMDMAX);
 
     /* Lock the vocabulary for consistent view during construction */
-    pthread_mutex_lock((pthread_mutex_t*)&words->mutex);
+    trace_lock((pthread_mutex_t*)&words->mutex, TRACE_LOCK_WORDS);
 
     size_t N = words->numWords;
     if (N == 0) {
@@ -129,55 +377,29 @@ int construct_command(const Words *words,
     }
     if (want_len > (int)N) want_len = (int)N;
 
-    int sample_size = (int)((double)N * (double)CLAMP(scope_pct, SRCHMIN, SRCHMAX) / 100.0 + 0.5);
-    if (sample_size < 1) sample_size = 1;
-    if (sample_size > (int)N) sample_size = (int)N;
-
-    /* Build candidate index list [0..N-1] and sample 'sample_size' without replacement */
-    int *candidates = (int*)malloc((size_t)N * sizeof(int));
-    if (!candidates) {
-        pthread_mutex_unlock((pthread_mutex_t*)&words->mutex);
-        out_cmd[0] = IDX_TERMINATOR;
-        return 0;
-    }
-    for (size_t i = 0; i < N; ++i) candidates[i] = (int)i;
-
-    /* Partial shuffle to select K candidates */
-    partial_shuffle(candidates, (int)N, sample_size);
-
-    /* Greedy construction using sparse associations */
+    Explore ex;
+    explore_init(words, explore, &ex);
     int chosen[CMDMAX];
-    int argc = 0;
-
-    /* Start: pick one at random among K candidates to avoid O(N^2) */
-    {
-        int pick_i = rand_between(0, sample_size - 1);
-        chosen[argc++] = candidates[pick_i];
-        /* remove from pool by swapping with the last of the sample window */
-        candidates[pick_i] = candidates[sample_size - 1];
-        sample_size--;
-    }
-
-    /* Continue greedy picks */
-    while (argc < want_len && sample_size > 0) {
-        int best_idx_in_cands = greedy_pick(words, candidates, sample_size, chosen, argc, argc);
-        if (best_idx_in_cands < 0) {
-            /* fallback: random */
-            best_idx_in_cands = rand_between(0, sample_size - 1);
-        }
-        int w = candidates[best_idx_in_cands];
-        chosen[argc++] = w;
-
-        /* remove selected from pool */
-        candidates[best_idx_in_cands] = candidates[sample_size - 1];
-        sample_size--;
-    }
+    int argc = budget_us > 0
+             ? construct_anytime(words, &ex, want_len, scope_pct, t0 + budget_us / 1e6, chosen)
+             : construct_exhaustive(words, &ex, want_len, scope_pct, scratch, chosen);
+    pthread_mutex_unlock((pthread_mutex_t*)&words->mutex);
 
     /* Output */
     for (int i = 0; i < argc; ++i) out_cmd[i] = chosen[i];
     out_cmd[argc] = IDX_TERMINATOR;
 
-    free(candidates);
-    pthread_mutex_unlock((pthread_mutex_t*)&words->mutex);
+    note_latency(now_monotonic_s() - t0);
     return argc;
 }
+
+void construct_latency(double *p50_us, double *p99_us, unsigned long *count) {
+    unsigned long hist[LAT_BUCKETS], n = 0;
+    for (int b = 0; b < LAT_BUCKETS; ++b) {
+        hist[b] = atomic_load_explicit(&g_lat[b], memory_order_relaxed);
+        n += hist[b];
+    }
+    if (count) *count = n;
+    if (p50_us) *p50_us = lat_percentile(hist, n, 0.50);
+    if (p99_us) *p99_us = lat_percentile(hist, n, 0.99);
+}
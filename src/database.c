@@ -15,12 +15,27 @@
 #include "config.h"
 #include "model.h"
 #include "assoc.h"
+#include "exestats.h"
+#include "pathcache.h"
+#include "split.h"
+#include "outclass.h"
+#include "normalize.h"
+#include "toktab.h"
+#include "bufpool.h"
+#include "dump.h"
+#include "prof.h"
+#include "trace.h"
+#include "stats.h"
 #include "learning.h"
+#include "memacct.h"
+#include "obsseg.h"
 #include "database.h"
 
 
 /* ---------- local helpers ---------- */
 
+static int ensure_parent_dir(const char *filepath);
+
 static char *dupstr_local(const char *s) {
     if (!s) return NULL;
     size_t n = strlen(s) + 1;
@@ -29,51 +44,335 @@ static char *dupstr_local(const char *s) {
     return p;
 }
 
-/* linear lookup. caller must hold words->mutex if racing with writers */
-static int find_token_index_unlocked(const Words *words, const char *tok) {
-    if (!words || !tok) return -1;
+/* lock-free lookup of the span tok[0..n) (see toktab.h) */
+static TokEntry *find_token_entry(const Words *words, const char *tok, size_t n) {
+    if (!words || !tok) return NULL;
+    return toktab_lookup(&words->lookup, tok, n);
+}
+
+/* id of NUL-terminated `tok`, or -1; lock-free like find_token_entry */
+static int find_token_index(const Words *words, const char *tok) {
+    const TokEntry *e = tok ? find_token_entry(words, tok, strlen(tok)) : NULL;
+    return e ? e->id : -1;
+}
+
+/* Fill metadata for token `idx` after its string was written and publish
+* it to the lookup table. Caller holds words->mutex. */
+static void finish_word_unlocked(Words *words, int idx) {
+    const char *t = words->token[idx];
+    size_t n = strlen(t);
+    words->meta.len[idx]   = (unsigned int)n;
+    words->meta.flags[idx] = (strpbrk(t, " " SHELL_METACHARS) ? TOK_META : 0);
+    words->meta.uses[idx]  = 0;
+    for (int j = 0; j < NEIGHBOR_SLOTS; ++j) words->meta.nbr[(size_t)idx * NEIGHBOR_SLOTS + j] = -1;
+    words->meta.nbr_next[idx] = 0;
+    memset(&words->meta.tries[(size_t)idx * CMDMAX], 0, CMDMAX * sizeof(*words->meta.tries));
+    (void)toktab_insert(&words->lookup, t, n, idx); /* on OOM the token is just never matched */
+}
+
+/* Bytes of metadata per token slot, summed over the arrays. */
+static size_t token_meta_stride(const TokenMeta *m) {
+    return sizeof(*m->len) + sizeof(*m->flags) + sizeof(*m->uses)
+         + NEIGHBOR_SLOTS * sizeof(*m->nbr) + sizeof(*m->nbr_next) + CMDMAX * sizeof(*m->tries);
+}
+
+/* Grow every metadata array to hold at least `need` entries. */
+static int grow_token_meta(TokenMeta *m, size_t need) {
+    if (need <= m->cap) return 0;
+    size_t ncap = m->cap ? m->cap * 2 : 256;
+    while (ncap < need) ncap *= 2;
+    #define GROW(field, per) do { \
+        void *p = realloc(m->field, ncap * (per) * sizeof(*m->field)); \
+        if (!p) return -1; \
+        m->field = p; \
+    } while (0)
+    GROW(len, 1); GROW(flags, 1); GROW(uses, 1);
+    GROW(nbr, NEIGHBOR_SLOTS); GROW(nbr_next, 1); GROW(tries, CMDMAX);
+    #undef GROW
+    memacct_add(MEM_TOKEN_META, (long)((ncap - m->cap) * token_meta_stride(m)));
+    m->cap = ncap;
+    return 0;
+}
+
+/* Remember b as a rewarded partner of a (ring of NEIGHBOR_SLOTS, no
+* duplicates). Caller holds words->mutex. */
+static void note_neighbor_unlocked(Words *words, int a, int b) {
+    if (a < 0 || b < 0 || a == b) return;
+    if ((size_t)a >= words->numWords || (size_t)b >= words->numWords) return;
+    int *slots = &words->meta.nbr[(size_t)a * NEIGHBOR_SLOTS];
+    for (int j = 0; j < NEIGHBOR_SLOTS; ++j) if (slots[j] == b) return;
+    slots[words->meta.nbr_next[a]] = b;
+    words->meta.nbr_next[a] = (unsigned char)((words->meta.nbr_next[a] + 1) % NEIGHBOR_SLOTS);
+}
+
+static void free_token_meta(TokenMeta *m) {
+    memacct_add(MEM_TOKEN_META, -(long)(m->cap * token_meta_stride(m)));
+    free(m->len); free(m->flags); free(m->uses);
+    free(m->nbr); free(m->nbr_next); free(m->tries);
+    memset(m, 0, sizeof(*m));
+}
+
+/* Mark token `idx` executable and add it to the dense exec index.
+* Caller holds words->mutex. */
+static void mark_executable_unlocked(Words *words, int idx) {
+    if (idx < 0 || (size_t)idx >= words->numWords || (words->meta.flags[idx] & TOK_EXEC)) return;
+    int *grown = (int *)realloc(words->exec_ids, (words->numExec + 1) * sizeof(*grown));
+    if (!grown) return;
+    memacct_add(MEM_TOKEN_META, (long)sizeof(*grown));
+    words->exec_ids = grown;
+    words->exec_ids[words->numExec++] = idx;
+    words->meta.flags[idx] |= TOK_EXEC;
+}
+
+/* Flag every loaded token that resolves on the current PATH. */
+static void flag_executables_from_path(Words *words) {
+    const char *envp = getenv("PATH");
+    if (!envp || !*envp) envp = "/usr/local/sbin:/usr/local/bin:/usr/sbin:/usr/bin:/sbin:/bin";
+    char *paths = dupstr_local(envp);
+    if (!paths) return;
+
+    char *dirs[PATHCACHE_MAX_DIRS];
+    int ndirs = 0;
+    char *saveptr = NULL;
+    for (char *d = strtok_r(paths, ":", &saveptr); d && ndirs < PATHCACHE_MAX_DIRS;
+         d = strtok_r(NULL, ":", &saveptr)) {
+        dirs[ndirs++] = d;
+    }
+
+    pthread_mutex_lock(&words->mutex);
     for (size_t i = 0; i < words->numWords; ++i) {
-        const char *w = words->token[i];
-        if (w && strcmp(w, tok) == 0) return (int)i;
+        if (words->token[i] && !(words->meta.flags[i] & TOK_EXEC) &&
+            path_lookup(dirs, ndirs, words->token[i], NULL, 0)) {
+            mark_executable_unlocked(words, (int)i);
+        }
+    }
+    pthread_mutex_unlock(&words->mutex);
+    free(paths);
+}
+
+/* Release token strings, the token array, metadata, lookup table and exec
+* index, leaving `w` empty. Caller holds w->mutex (or owns `w`). */
+static void free_token_storage_unlocked(Words *w) {
+    long bytes = 0;   /* as charged by reallocate_words: a slot plus its string */
+    if (w->token) {
+        for (size_t i = 0; i < w->numWords; ++i) {
+            if (w->token[i]) bytes += (long)(sizeof(*w->token) + w->meta.len[i] + 1);
+            free(w->token[i]);
+        }
+        free(w->token);
+        w->token = NULL;
     }
-    return -1;
+    memacct_add(MEM_TOKENS, -bytes);
+    free_token_meta(&w->meta);
+    toktab_free(&w->lookup);
+    memacct_add(MEM_TOKEN_META, -(long)(w->numExec * sizeof(*w->exec_ids)));
+    free(w->exec_ids);
+    w->exec_ids = NULL;
+    w->numWords = 0;
+    w->numExec = 0;
+}
+
+/* Bytes of a stored observation row, terminator included. */
+static size_t obs_row_bytes(const int *row) {
+    size_t n = 0;
+    while (row[n] != IDX_TERMINATOR) n++;
+    return (n + 1) * sizeof(*row);
+}
+
+/* Map segment `seq` of o->segdir and add it to the cold tier. Caller holds o->mutex. */
+static int add_segment_unlocked(Observations *o, unsigned int seq) {
+    ObsSegment seg;
+    if (obsseg_open(&seg, o->segdir, seq) != 0) return -1;
+    ObsSegment *grown = (ObsSegment *)realloc(o->segs, (o->numSegments + 1) * sizeof(*grown));
+    if (!grown) { obsseg_close(&seg); return -1; }
+    memacct_add(MEM_OBS_INDEX, (long)sizeof(*grown));
+    o->segs = grown;
+    o->segs[o->numSegments++] = seg;
+    o->numCold += seg.nrows;
+    return 0;
 }
 
-/* Tokenize a free-form line by whitespace into known token indices.
-* Returns malloc'd int[] terminated by IDX_TERMINATOR, or NULL if none. */
-static int *tokenize_to_indices(Words *words, const char *line) {
-    if (!words || !line) return NULL;
+/* Sequence number of the next segment to be sealed into *seq, the one
+* being written if a seal is in flight. Returns 0 if lines are not sealed
+* at all (no segment directory and no segments). */
+static int next_segment_seq(const Observations *o, unsigned int *seq) {
+    if (o->numSealing) *seq = o->sealSeq;
+    else if (o->numSegments) *seq = o->segs[o->numSegments - 1].seq + 1;
+    else if (o->segdir) *seq = 0;
+    else return 0;
+    return 1;
+}
 
-    int count = 0;
-    char *tmp = dupstr_local(line);
-    if (!tmp) return NULL;
+/* Stop sealing: every line from now on stays hot. */
+static void drop_segdir_unlocked(Observations *o) {
+    if (!o->segdir) return;
+    memacct_add(MEM_OBS_INDEX, -(long)(strlen(o->segdir) + 1));
+    free(o->segdir);
+    o->segdir = NULL;
+}
 
-    /* count known tokens first */
-    char *save = NULL;
-    for (char *t = strtok_r(tmp, " \t\r\n", &save); t; t = strtok_r(NULL, " \t\r\n", &save)) {
-        pthread_mutex_lock(&words->mutex);
-        int idx = find_token_index_unlocked(words, t);
-        pthread_mutex_unlock(&words->mutex);
-        if (idx >= 0) count++;
+/* Free `n` sealed lines and the array holding them. Caller holds o->mutex. */
+static void free_sealed_rows_unlocked(int **rows, size_t n) {
+    long bytes = 0;
+    for (size_t i = 0; i < n; ++i) {
+        bytes += (long)obs_row_bytes(rows[i]);
+        free(rows[i]);
     }
-    free(tmp);
-    if (count == 0) return NULL;
-
-    int *arr = (int *)malloc(((size_t)count + 1) * sizeof(int));
-    if (!arr) return NULL;
-    int pos = 0;
-    char *tmp2 = dupstr_local(line);
-    if (!tmp2) { free(arr); return NULL; }
-    char *save2 = NULL;
-    for (char *t = strtok_r(tmp2, " \t\r\n", &save2); t; t = strtok_r(NULL, " \t\r\n", &save2)) {
-        pthread_mutex_lock(&words->mutex);
-        int idx = find_token_index_unlocked(words, t);
-        pthread_mutex_unlock(&words->mutex);
-        if (idx >= 0) arr[pos++] = idx;
+    memacct_add(MEM_OBS_ROWS, -bytes);
+    memacct_add(MEM_OBS_INDEX, -(long)(n * sizeof(*rows)));
+    free(rows);
+}
+
+/* Once more than OBS_HOT_ROWS lines are hot, move the oldest
+* OBS_SEGMENT_ROWS of them into a new segment. Only detaching the lines and
+* swapping the mapped segment in take o->mutex; the segment is written
+* without it, so other workers keep checking and appending meanwhile (the
+* detached lines stay visible to them in o->sealing). On a write failure
+* sealing is turned off and the lines stay in memory. Call without o->mutex. */
+static void seal_if_due(Observations *o) {
+    if (OBS_HOT_ROWS <= 0) return;
+    pthread_mutex_lock(&o->mutex);
+    if (!o->segdir || o->sealing || o->numObservations <= OBS_HOT_ROWS) {
+        pthread_mutex_unlock(&o->mutex);
+        return;
+    }
+    size_t n = OBS_SEGMENT_ROWS;
+    int **rows = (int **)malloc(n * sizeof(*rows));
+    if (!rows) {
+        pthread_mutex_unlock(&o->mutex);
+        return;
+    }
+    memcpy(rows, o->entries, n * sizeof(*rows));
+    o->numObservations -= n;
+    memmove(o->entries, o->entries + n, o->numObservations * sizeof(*o->entries));
+    int **shrunk = (int **)realloc(o->entries, (o->numObservations ? o->numObservations : 1) * sizeof(*shrunk));
+    if (shrunk) o->entries = shrunk;
+    unsigned int seq = o->numSegments ? o->segs[o->numSegments - 1].seq + 1 : 0;
+    o->sealing = rows;
+    o->numSealing = n;
+    o->sealSeq = seq;
+    const char *dir = o->segdir;   /* only freed under the mutex while o->sealing is NULL */
+    pthread_mutex_unlock(&o->mutex);
+
+    char path[PATH_MAX];
+    int ok = obsseg_path(path, sizeof(path), dir, seq) == 0 && ensure_parent_dir(path) == 0 &&
+             obsseg_write(dir, seq, rows, n) == 0;
+
+    trace_lock(&o->mutex, TRACE_LOCK_OBS);
+    if (ok && add_segment_unlocked(o, seq) == 0) {
+        o->sealing = NULL;
+        o->numSealing = 0;
+        free_sealed_rows_unlocked(rows, n);
+#if LOG_ACTIONS
+        fprintf(stdout, "[obs] sealed %zu line(s) into %s (%zu cold in %zu segment(s))\n",
+                n, path, o->numCold, o->numSegments);
+#endif
+    } else {
+        /* the lines stay in o->sealing for good: checked and saved as before */
+        fprintf(stderr, "[warn] could not seal observations into %s; keeping them in memory\n", o->segdir);
+        drop_segdir_unlocked(o);
+    }
+    pthread_mutex_unlock(&o->mutex);
+}
+
+/* Append `row` (heap, terminated) to the store; ownership passes on
+* success. Caller holds o->mutex and calls seal_if_due after releasing it.
+* Returns 0, or -1 on OOM. */
+static int append_observation_unlocked(Observations *o, int *row) {
+    int **newv = (int **)realloc(o->entries, (o->numObservations + 1) * sizeof(*newv));
+    if (!newv) return -1;
+    o->entries = newv;
+    o->entries[o->numObservations++] = row;
+    memacct_add(MEM_OBS_INDEX, (long)sizeof(*newv));
+    memacct_add(MEM_OBS_ROWS, (long)obs_row_bytes(row));
+    return 0;
+}
+
+/* Release both tiers. Caller holds o->mutex (or owns `o`); segment files stay on disk. */
+static void free_observation_rows_unlocked(Observations *o) {
+    long rows = 0;
+    for (size_t i = 0; i < o->numObservations; ++i) {
+        rows += (long)obs_row_bytes(o->entries[i]);
+        free(o->entries[i]);   /* each is an int* (tokenized line) */
+    }
+    memacct_add(MEM_OBS_ROWS, -rows);
+    memacct_add(MEM_OBS_INDEX, -(long)(o->numObservations * sizeof(*o->entries)));
+    free(o->entries);
+    o->entries = NULL;
+    o->numObservations = 0;
+    if (o->sealing) free_sealed_rows_unlocked(o->sealing, o->numSealing);
+    o->sealing = NULL;
+    o->numSealing = 0;
+
+    for (size_t i = 0; i < o->numSegments; ++i) obsseg_close(&o->segs[i]);
+    memacct_add(MEM_OBS_INDEX, -(long)(o->numSegments * sizeof(*o->segs)));
+    free(o->segs);
+    o->segs = NULL;
+    o->numSegments = 0;
+    o->numCold = 0;
+    drop_segdir_unlocked(o);
+}
+
+/* Cold-tier redundancy check, newest segment first. Caller holds o->mutex. */
+static int redundant_in_segments_unlocked(const Observations *o, const int *line, int nline,
+                                          int *best_index, float *best_score) {
+    if (o->numSegments == 0 || nline <= 0) return 0;
+    ObsProbe probe;
+    obsseg_probe_init(&probe, line, nline, REDUNDANCY_THRESHOLD);
+    size_t before = o->numCold;
+    for (size_t i = o->numSegments; i-- > 0;) {
+        const ObsSegment *seg = &o->segs[i];
+        before -= seg->nrows;
+        size_t row = 0;
+        float prev = *best_score;
+        int hit = obsseg_redundant(seg, &probe, REDUNDANCY_THRESHOLD, &row, best_score);
+        /* cold lines are numbered before the hot ones, oldest first */
+        if (*best_score > prev) *best_index = (int)(before + row);
+        if (hit) return 1;
+    }
+    return 0;
+}
+
+typedef struct {
+    Words  *words;
+    IntBuf *ids;
+    int     normalize;
+} TokenizeCtx;
+
+/* split_whitespace callback: append the span's class id (normalize.h) if it
+* is a volatile token, else its vocabulary id if known */
+static int tokenize_span(const char *tok, size_t len, void *vctx) {
+    TokenizeCtx *tc = (TokenizeCtx *)vctx;
+    int idx = tc->normalize ? normalize_token_class(tok, len) : 0;
+    if (idx) {
+        normalize_note(idx);
+    } else {
+        /* lock-free: inserts by other threads never block this */
+        TokEntry *e = find_token_entry(tc->words, tok, len);
+        if (!e) return 0;
+        atomic_fetch_add_explicit(&e->hits, 1, memory_order_relaxed);
+        idx = e->id;
     }
-    free(tmp2);
-    arr[pos] = IDX_TERMINATOR;
-    return arr;
+
+    if (intbuf_reserve(tc->ids, tc->ids->len + 2) != 0) return 1;
+    tc->ids->data[tc->ids->len++] = idx;
+    return 0;
+}
+
+/* Tokenize line[0..len) by whitespace into known token indices, with
+* volatile tokens mapped to negative class ids when normalization is on.
+* The line is split in place (see split.h) in a single pass into `ids`
+* (reused; contents replaced). Returns ids->data terminated by
+* IDX_TERMINATOR, or NULL if no token matched. */
+static int *tokenize_to_indices(Words *words, const char *line, size_t len, IntBuf *ids) {
+    if (!words || !line || !ids) return NULL;
+
+    ids->len = 0;
+    TokenizeCtx tc = { words, ids, output_normalization_enabled() };
+    split_whitespace(line, len, tokenize_span, &tc);
+    if (ids->len == 0) return NULL;
+    ids->data[ids->len] = IDX_TERMINATOR;
+    return ids->data;
 }
 
 /* ensure parent directory of a file path exists (mkdir -p style, best-effort) */
@@ -108,21 +407,27 @@ void init_words(Words *w) {
     if (!w) return;
     w->token = NULL;
     w->numWords = 0;
+    memset(&w->meta, 0, sizeof(w->meta));
+    (void)toktab_init(&w->lookup, 0);
+    w->exec_ids = NULL;
+    w->numExec = 0;
+    memset(w->pos_tries, 0, sizeof(w->pos_tries));
+    (void)trycount_init(&w->pair_tries, 0);  /* on OOM every pair just reads as untried */
     pthread_mutex_init(&w->mutex, NULL);
     (void)assoc_init(&w->assoc, 0);  /* 0 = default bucket hint */
+    (void)exestats_init(&w->exestats, 0);
 }
 
 void free_words(Words *w) {
     if (!w) return;
     pthread_mutex_lock(&w->mutex);
-    for (size_t i = 0; i < w->numWords; ++i) free(w->token[i]);
-    free(w->token);
-    w->token = NULL;
-    w->numWords = 0;
+    free_token_storage_unlocked(w);
     pthread_mutex_unlock(&w->mutex);
  
     /* free assoc before destroying the mutex (no dependency either way here) */
     assoc_free(&w->assoc);
+    trycount_free(&w->pair_tries);
+    exestats_free(&w->exestats);
     pthread_mutex_destroy(&w->mutex);
 }
 
@@ -135,6 +440,12 @@ void reallocate_words(Words *words, int wordLength) {
 
     size_t newCount = words->numWords + 1;
 
+    /* grow the metadata arrays first; spare capacity there is harmless */
+    if (grow_token_meta(&words->meta, newCount) != 0) return;
+    words->meta.len[words->numWords]   = (unsigned int)wordLength;
+    words->meta.flags[words->numWords] = 0;
+    words->meta.uses[words->numWords]  = 0;
+
     /* grow the token pointer array by 1 */
     char **grown = (char **)realloc(words->token, newCount * sizeof(*grown));
     if (!grown) return; /* keep old on failure */
@@ -143,48 +454,124 @@ void reallocate_words(Words *words, int wordLength) {
     char *slot = (char *)malloc((size_t)wordLength + 1);
     words->token[words->numWords] = slot; /* may be NULL */
     words->numWords = newCount;
+    if (slot) memacct_add(MEM_TOKENS, (long)(sizeof(*grown) + (size_t)wordLength + 1));
+}
+
+int add_word(Words *words, const char *tok) {
+    if (!words || !tok || !*tok) return -1;
+    pthread_mutex_lock(&words->mutex);
+    int idx = find_token_index(words, tok);
+    if (idx < 0) {
+        size_t before = words->numWords;
+        reallocate_words(words, (int)strlen(tok));
+        if (words->numWords > before) {
+            if (words->token[before]) {
+                strcpy(words->token[before], tok);
+                finish_word_unlocked(words, (int)before);
+                idx = (int)before;
+            } else {
+                /* slot alloc failed -> remove the NULL slot */
+                words->numWords--;
+            }
+        }
+    }
+    pthread_mutex_unlock(&words->mutex);
+    return idx;
+}
+
+int append_observation(Observations *o, int *row) {
+    if (!o || !row) return -1;
+    pthread_mutex_lock(&o->mutex);
+    int rc = append_observation_unlocked(o, row);
+    pthread_mutex_unlock(&o->mutex);
+    if (rc == 0) seal_if_due(o);
+    return rc;
 }
 
 void init_observations(Observations *o) {
     if (!o) return;
     o->entries = NULL;
     o->numObservations = 0;
+    o->sealing = NULL;
+    o->numSealing = 0;
+    o->sealSeq = 0;
+    o->segs = NULL;
+    o->numSegments = 0;
+    o->numCold = 0;
+    o->segdir = NULL;
+    (void)blobset_init(&o->blobs, 0);  /* on failure binary outputs are never novel */
     pthread_mutex_init(&o->mutex, NULL);
 }
 
 void free_observations(Observations *o) {
     if (!o) return;
     pthread_mutex_lock(&o->mutex);
-    for (size_t i = 0; i < o->numObservations; ++i) free(o->entries[i]);
-    free(o->entries);
-    o->entries = NULL;
-    o->numObservations = 0;
+    free_observation_rows_unlocked(o);
     pthread_mutex_unlock(&o->mutex);
+    blobset_free(&o->blobs);
     pthread_mutex_destroy(&o->mutex);
 }
 
+static int cmp_uint(const void *a, const void *b) {
+    unsigned int x = *(const unsigned int *)a, y = *(const unsigned int *)b;
+    return (x > y) - (x < y);
+}
+
+int attach_observation_segments(Observations *o, const char *dir) {
+    if (!o || !dir || !*dir) return -1;
+    pthread_mutex_lock(&o->mutex);
+    drop_segdir_unlocked(o);
+    o->segdir = dupstr_local(dir);
+    if (!o->segdir) { pthread_mutex_unlock(&o->mutex); return -1; }
+    memacct_add(MEM_OBS_INDEX, (long)(strlen(dir) + 1));
+
+    /* seg-<seq>.bin files, mapped in sequence order (oldest first) */
+    unsigned int *seqs = NULL;
+    size_t nseq = 0, cap = 0;
+    DIR *dh = opendir(dir);
+    struct dirent *ent;
+    while (dh && (ent = readdir(dh)) != NULL) {
+        unsigned int seq;
+        int end = 0;
+        if (sscanf(ent->d_name, "seg-%u.bin%n", &seq, &end) != 1 || ent->d_name[end] != '\0') continue;
+        if (nseq == cap) {
+            size_t nc = cap ? cap * 2 : 64;
+            unsigned int *g = (unsigned int *)realloc(seqs, nc * sizeof(*g));
+            if (!g) break;
+            seqs = g;
+            cap = nc;
+        }
+        seqs[nseq++] = seq;
+    }
+    if (dh) closedir(dh);
+    if (nseq) qsort(seqs, nseq, sizeof(*seqs), cmp_uint);
+    for (size_t i = 0; i < nseq; ++i) {
+        if (add_segment_unlocked(o, seqs[i]) != 0) {
+            fprintf(stderr, "[warn] %s: skipping unreadable segment %u\n", dir, seqs[i]);
+        }
+    }
+    free(seqs);
+#if LOG_ACTIONS
+    if (o->numSegments) {
+        fprintf(stdout, "[obs] mapped %zu cold line(s) in %zu segment(s) from %s\n",
+                o->numCold, o->numSegments, dir);
+    }
+#endif
+    pthread_mutex_unlock(&o->mutex);
+    return 0;
+}
+
 void cleanup_database(Words *words, Observations *obs) {
     if (obs) {
-        if (obs->entries) {
-            for (size_t i = 0; i < obs->numObservations; ++i) {
-                free(obs->entries[i]);   /* each is an int* (tokenized line) */
-            }
-            free(obs->entries);
-            obs->entries = NULL;
-        }
-        obs->numObservations = 0;
+        free_observation_rows_unlocked(obs);
+        blobset_free(&obs->blobs);
         pthread_mutex_destroy(&obs->mutex);
     }
     if (words) {
-        if (words->token) {
-            for (size_t i = 0; i < words->numWords; ++i) {
-                free(words->token[i]);
-            }
-            free(words->token);
-            words->token = NULL;
-        }
-        words->numWords = 0;
+        free_token_storage_unlocked(words);
         assoc_free(&words->assoc);
+        trycount_free(&words->pair_tries);
+        exestats_free(&words->exestats);
         pthread_mutex_destroy(&words->mutex);
     }
 }
@@ -202,17 +589,7 @@ static int load_tokens(Words *w, const char *tokens_path) {
         while (n && (buf[n-1] == '\n' || buf[n-1] == '\r')) buf[--n] = '\0';
         if (!*buf) continue;
 
-        pthread_mutex_lock(&w->mutex);
-        if (find_token_index_unlocked(w, buf) < 0) {
-            reallocate_words(w, (int)strlen(buf));
-            if (w->token[w->numWords - 1]) {
-                strcpy(w->token[w->numWords - 1], buf);
-            } else {
-                /* slot alloc failed -> remove the NULL slot */
-                if (w->numWords > 0) w->numWords--;
-            }
-        }
-        pthread_mutex_unlock(&w->mutex);
+        (void)add_word(w, buf);
     }
     fclose(fp);
     return 0;
@@ -227,6 +604,7 @@ static int load_values(Words *w, const char *assoc_path) {
     int i, pi, k, pk, v;
     while (fscanf(fp, "%d\t%d\t%d\t%d\t%d", &i, &pi, &k, &pk, &v) == 5) {
         assoc_add(&w->assoc, i, pi, k, pk, v);
+        if (v > 0) note_neighbor_unlocked(w, i, k);
         int c; while ((c = fgetc(fp)) != '\n' && c != EOF) {}
     }
 
@@ -239,11 +617,27 @@ static int load_observations(Observations *o, const char *obs_path) {
     FILE *fp = fopen(obs_path, "r");
     if (!fp) return (errno == ENOENT) ? 0 : -1;
 
+    /* Lines the file holds that were sealed after it was written (see
+     * write_obs_file). Counted before loading, which may seal more. */
+    size_t skip = 0;
     char *line = NULL;
     size_t cap = 0;
     ssize_t len;
     while ((len = getline(&line, &cap, fp)) != -1) {
         if (len <= 0) continue;
+        if (line[0] == '#') {
+            unsigned int next;
+            if (sscanf(line, "#next-segment %u", &next) == 1) {
+                pthread_mutex_lock(&o->mutex);
+                skip = 0;
+                for (size_t s = 0; s < o->numSegments; ++s) if (o->segs[s].seq >= next) skip += o->segs[s].nrows;
+                pthread_mutex_unlock(&o->mutex);
+#if LOG_ACTIONS
+                if (skip) fprintf(stdout, "[obs] %zu line(s) of %s are already sealed; skipping them\n", skip, obs_path);
+#endif
+            }
+            continue;
+        }
 
         /* count ints */
         int count = 0;
@@ -255,6 +649,7 @@ static int load_observations(Observations *o, const char *obs_path) {
         }
         free(tmp);
         if (count == 0) continue;
+        if (skip) { skip--; continue; }
 
         int *arr = (int *)malloc(((size_t)count + 1) * sizeof(int));
         if (!arr) continue;
@@ -269,14 +664,7 @@ static int load_observations(Observations *o, const char *obs_path) {
         free(tmp2);
         if (pos == 0 || arr[pos-1] != IDX_TERMINATOR) arr[pos++] = IDX_TERMINATOR;
 
-        pthread_mutex_lock(&o->mutex);
-        int **newv = (int **)realloc(o->entries, (o->numObservations + 1) * sizeof(*newv));
-        if (newv) {
-            o->entries = newv;
-            o->entries[o->numObservations++] = arr;
-            arr = NULL;
-        }
-        pthread_mutex_unlock(&o->mutex);
+        if (append_observation(o, arr) == 0) arr = NULL;
         free(arr);
     }
     free(line);
@@ -288,6 +676,7 @@ static int load_observations(Observations *o, const char *obs_path) {
 int load_database(Words *w, Observations *o, const char *tokens_path, const char *assoc_path, const char *obs_path) {
     if (!w || !o) return -1;
     if (tokens_path && *tokens_path) if (load_tokens(w, tokens_path) != 0) return -1;
+    flag_executables_from_path(w);
     if (assoc_path && *assoc_path)   if (load_values(w, assoc_path) != 0) return -1;
     if (obs_path && *obs_path)       if (load_observations(o, obs_path) != 0) return -1;
     return 0;
@@ -315,22 +704,56 @@ static int write_tokens_file(const Words *w, const char *tokens_path) {
     return 0;
 }
 
+/* Buckets [lo, hi) of the association table as i\tpi\tk\tpk\tvalue rows. */
+static long format_assoc_rows(ByteBuf *out, size_t lo, size_t hi, void *ctx) {
+    AssocIter it;
+    assoc_iter_range((const Assoc *)ctx, &it, lo, hi);
+    int f[5];
+    long rows = 0;
+    while (assoc_iter_next(&it, &f[0], &f[1], &f[2], &f[3], &f[4])) {
+        if (bytebuf_reserve(out, out->len + 5 * 12) != 0) return -1;
+        for (int j = 0; j < 5; ++j) {
+            dump_put_int(out, f[j]);
+            out->data[out->len++] = j < 4 ? '\t' : '\n';
+        }
+        ++rows;
+    }
+    return rows;
+}
+
+/* In-memory observation rows [lo, hi), the lines being sealed first, space
+* separated and ending in IDX_TERMINATOR. */
+static long format_obs_rows(ByteBuf *out, size_t lo, size_t hi, void *ctx) {
+    const Observations *o = (const Observations *)ctx;
+    long rows = 0;
+    for (size_t li = lo; li < hi; ++li) {
+        const int *row = li < o->numSealing ? o->sealing[li] : o->entries[li - o->numSealing];
+        if (!row) continue;
+        size_t n = 0;
+        while (row[n] != IDX_TERMINATOR) ++n;
+        if (bytebuf_reserve(out, out->len + (n + 1) * 12 + 1) != 0) return -1;
+        for (size_t j = 0; j < n; ++j) {
+            if (j) out->data[out->len++] = ' ';
+            dump_put_int(out, row[j]);
+        }
+        out->data[out->len++] = ' ';
+        dump_put_int(out, IDX_TERMINATOR);
+        out->data[out->len++] = '\n';
+        ++rows;
+    }
+    return rows;
+}
+
 static int write_assoc_file(const Words *w, const char *assoc_path) {
     if (!assoc_path || !*assoc_path) return 0;
     ensure_parent_dir(assoc_path);
     FILE *fp = fopen(assoc_path, "w");
     if (!fp) { perror("fopen values"); return -1; }
 
-    AssocIter it;
-    assoc_iter_init(&w->assoc, &it);
-    int i, pi, k, pk, v;
     size_t rows = 0;
-    while (assoc_iter_next(&it, &i, &pi, &k, &pk, &v)) {
-        fprintf(fp, "%d\t%d\t%d\t%d\t%d\n", i, pi, k, pk, v);
-        ++rows;
-    }
-    fflush(fp);
-    fclose(fp);
+    int rc = dump_chunked(fp, w->assoc.nbuckets, format_assoc_rows, (void *)&w->assoc, &rows);
+    if (fclose(fp) != 0) rc = -1;
+    if (rc != 0) { fprintf(stderr, "[persist] failed writing %s\n", assoc_path); return -1; }
 
 #if LOG_ACTIONS
     fprintf(stdout, "[persist] wrote %zu assoc rows -> %s\n", rows, assoc_path);
@@ -344,20 +767,16 @@ static int write_obs_file(const Observations *o, const char *obs_path) {
     FILE *fp = fopen(obs_path, "w");
     if (!fp) { perror("fopen observations"); return -1; }
 
-    size_t rows = 0;
-    for (size_t li = 0; li < o->numObservations; ++li) {
-        const int *row = o->entries[li];
-        if (!row) continue;
-        for (int j = 0; row[j] != IDX_TERMINATOR; ++j) {
-            if (j) fputc(' ', fp);
-            fprintf(fp, "%d", row[j]);
-        }
-        fprintf(fp, " %d\n", IDX_TERMINATOR);
-        ++rows;
-    }
+    /* Segments sealed after this point take their lines from the front of
+     * this file; if the process dies before the next save, load_observations
+     * skips as many lines as segments numbered >= this one hold. */
+    unsigned int next;
+    if (next_segment_seq(o, &next)) fprintf(fp, "#next-segment %u\n", next);
 
-    fflush(fp);
-    fclose(fp);
+    size_t rows = 0;
+    int rc = dump_chunked(fp, o->numSealing + o->numObservations, format_obs_rows, (void *)o, &rows);
+    if (fclose(fp) != 0) rc = -1;
+    if (rc != 0) { fprintf(stderr, "[persist] failed writing %s\n", obs_path); return -1; }
 
 #if LOG_ACTIONS
     fprintf(stdout, "[persist] wrote %zu observations -> %s\n", rows, obs_path);
@@ -365,15 +784,44 @@ static int write_obs_file(const Observations *o, const char *obs_path) {
     return 0;
 }
 
+typedef struct {
+    const Words *w;
+    const char  *path;
+    int          rc;
+} PersistJob;
+
+static void *tokens_job(void *arg) {
+    PersistJob *j = (PersistJob *)arg;
+    j->rc = write_tokens_file(j->w, j->path);
+    return NULL;
+}
+
+static void *assoc_job(void *arg) {
+    PersistJob *j = (PersistJob *)arg;
+    j->rc = write_assoc_file(j->w, j->path);
+    return NULL;
+}
+
 /* database.h: void write_database(...) */
 void write_database(const Words *w, const Observations *o, const char *tokens_path, const char *assoc_path, const char *obs_path) {
     if (!w || !o) return;
 #if LOG_ACTIONS
     fprintf(stdout, "[persist] writing database…\n");
 #endif
-    (void)write_tokens_file(w, tokens_path);
-    (void)write_assoc_file(w, assoc_path);
+    ProfMark pm;
+    prof_begin(&pm);
+    /* The three files are independent: tokens and assoc get a thread each
+     * (run inline if the spawn fails), observations are written here. */
+    PersistJob tj = { w, tokens_path, 0 }, aj = { w, assoc_path, 0 };
+    pthread_t ttid, atid;
+    int t_started = pthread_create(&ttid, NULL, tokens_job, &tj) == 0;
+    if (!t_started) tokens_job(&tj);
+    int a_started = pthread_create(&atid, NULL, assoc_job, &aj) == 0;
+    if (!a_started) assoc_job(&aj);
     (void)write_obs_file(o, obs_path);
+    if (t_started) (void)pthread_join(ttid, NULL);
+    if (a_started) (void)pthread_join(atid, NULL);
+    prof_end(PROF_PERSIST, &pm);
 #if LOG_ACTIONS
     fprintf(stdout, "[persist] done.\n");
 #endif
@@ -446,18 +894,22 @@ int seed_vocabulary_from_path(Words *words, const char *path_env_override) {
             if ((st.st_mode & (S_IXUSR|S_IXGRP|S_IXOTH)) == 0) continue;
 
             pthread_mutex_lock(&words->mutex);
-            int already = find_token_index_unlocked(words, ent->d_name);
+            int already = find_token_index(words, ent->d_name);
             if (already < 0) {
-                size_t len = strlen(ent->d_name);
+                size_t len = strlen(ent->d_name), before = words->numWords;
                 reallocate_words(words, (int)len);
-                if (words->token[words->numWords - 1]) {
-                    memcpy(words->token[words->numWords - 1], ent->d_name, len + 1);
+                if (words->numWords > before && words->token[before]) {
+                    memcpy(words->token[before], ent->d_name, len + 1);
+                    finish_word_unlocked(words, (int)before);
+                    mark_executable_unlocked(words, (int)before);
                     added_this_dir++;
                     total_added++;
                 } else {
                     /* remove NULL slot on failure */
-                    if (words->numWords > 0) words->numWords--;
+                    if (words->numWords > before) words->numWords--;
                 }
+            } else {
+                mark_executable_unlocked(words, already);
             }
             pthread_mutex_unlock(&words->mutex);
 
@@ -490,30 +942,84 @@ int seed_vocabulary_from_path(Words *words, const char *path_env_override) {
 
 /* ---------- learning update ---------- */
 
-int update_database(Words *words, Observations *obs, char *output, int *cmd_indices) {
+/* Normalize a base reward by what the command cost to run: positive rewards
+* are divided by the cost factor (never below 1), penalties multiplied by it,
+* so slow or output-heavy commands are worth less than cheap informative ones. */
+static int cost_scaled_reward(int base, const ExecStats *stats) {
+    if (!stats) return base;
+    double cost = 1.0
+                + stats->wall_s / COST_WALL_UNIT_S
+                + stats->cpu_s  / COST_CPU_UNIT_S
+                + (double)stats->out_bytes / COST_BYTES_UNIT;
+    if (cost > COST_MAX_FACTOR) cost = COST_MAX_FACTOR;
+
+    if (base > 0) {
+        int r = (int)((double)base / cost + 0.5);
+        return r < 1 ? 1 : r;
+    }
+    return (int)((double)base * cost - 0.5);
+}
+
+int update_database(Words *words, Observations *obs, char *output, int *cmd_indices,
+                    const ExecStats *stats, int *out_novel, WorkerBuffers *bufs) {
+    if (out_novel) *out_novel = 0;
     if (!words || !obs || !output || !cmd_indices) return 0;
 
-    /* Tokenize the command output into known token indices (may be NULL). */
-    int *line = tokenize_to_indices(words, output);
+    /* token ids go to the worker's scratch buffer, or a local one */
+    IntBuf local_ids = {0};
+    IntBuf *ids = bufs ? &bufs->idx : &local_ids;
 
+    int novel = 0;
     int redundant = 0;
     int reward = 1; /* default: positive reward */
+    int *line = NULL;
+
+    /* Binary output is not worth tokenizing: dedup by content hash only. */
+    ProfMark pm;
+    prof_begin(&pm);
+    size_t out_len = stats ? stats->out_bytes : strlen(output);
+    OutputClass oc = classify_output(output, out_len);
+    stats_note_output(oc, out_len);
+    if (oc == OUTPUT_BINARY) {
+        novel = blobset_insert(&obs->blobs, blob_hash(output, out_len));
+        reward = novel ? BINARY_REWARD : -PENALTY;
+    } else {
+        /* Tokenize the command output into known token indices (may be NULL). */
+        line = tokenize_to_indices(words, output, out_len, ids);
+    }
+    prof_end(PROF_TOKENIZE, &pm);
 
     if (line) {
         /* compute effective length of the tokenized output */
         int nline = 0;
-        while (line[nline] != IDX_TERMINATOR && nline < CMDMAX * 4) nline++;
+        while (line[nline] != IDX_TERMINATOR && nline < OBS_COMPARE_MAX) nline++;
 
-        /* Check redundancy against all observations; learning.c can internally
-         * *           prefer more recent ones if desired. */
-        pthread_mutex_lock(&obs->mutex);
+        /* Check redundancy against the hot lines, then the cold segments
+         * through their token indexes and signatures (obsseg.h). */
+        trace_lock(&obs->mutex, TRACE_LOCK_OBS);
         int best_index = -1;
         float best_score = 0.0f;
+        prof_begin(&pm);
         redundant = is_redundant_line_proximity(
             line, nline,
             obs->entries, obs->numObservations,
             REDUNDANCY_THRESHOLD,
             &best_index, &best_score);
+        if (best_index >= 0) best_index += (int)(obs->numCold + obs->numSealing);
+        if (!redundant && obs->numSealing) {
+            int sidx = -1;
+            float sscore = 0.0f;
+            redundant = is_redundant_line_proximity(line, nline, obs->sealing, obs->numSealing,
+                                                    REDUNDANCY_THRESHOLD, &sidx, &sscore);
+            if (sidx >= 0 && sscore > best_score) {
+                best_score = sscore;
+                best_index = (int)obs->numCold + sidx;
+            }
+        }
+        if (!redundant) {
+            redundant = redundant_in_segments_unlocked(obs, line, nline, &best_index, &best_score);
+        }
+        prof_end(PROF_REDUNDANCY, &pm);
 
 #if VERBOSE_LOG
         if (redundant) {
@@ -523,18 +1029,21 @@ int update_database(Words *words, Observations *obs, char *output, int *cmd_indi
 
         /* Append observation if desired */
         if (!redundant || STORE_REDUNDANT) {
-            int **newv = (int **)realloc(obs->entries, (obs->numObservations + 1) * sizeof(*newv));
-            if (newv) {
-                obs->entries = newv;
-                obs->entries[obs->numObservations++] = line;
-                line = NULL; /* ownership transferred */
-            }
+            /* line lives in scratch memory: store an exact-size copy */
+            int *row = (int *)malloc((ids->len + 1) * sizeof(*row));
+            if (row) memcpy(row, line, (ids->len + 1) * sizeof(*row));
+            if (row && append_observation_unlocked(obs, row) != 0) free(row);
         }
         pthread_mutex_unlock(&obs->mutex);
+        seal_if_due(obs);
 
-        if (line) free(line); /* only free if we did NOT append */
         reward = redundant ? -PENALTY : REWARD;   // from config.h
+        novel = !redundant;
+    } else if (stats && stats->exit_code == 127) {
+        /* leader could not be found/executed: nothing to learn, it's a miss */
+        reward = -PENALTY;
     }
+    reward = cost_scaled_reward(reward, stats);
 
     /* Update sparse association map with pairwise co-occurrences */
     int vals[CMDMAX];
@@ -547,15 +1056,34 @@ int update_database(Words *words, Observations *obs, char *output, int *cmd_indi
     }
 
     if (argc > 0) {
-        pthread_mutex_lock(&words->mutex);
+        trace_lock(&words->mutex, TRACE_LOCK_WORDS);
+        prof_begin(&pm);
         for (int a = 0; a < argc; ++a) {
+            if (vals[a] >= 0 && (size_t)vals[a] < words->numWords) {
+                unsigned short *t = &words->meta.tries[(size_t)vals[a] * CMDMAX + (size_t)pos[a]];
+                words->meta.uses[vals[a]]++;
+                if (*t < USHRT_MAX) (*t)++;
+                words->pos_tries[pos[a]]++;
+            }
             for (int b = 0; b < argc; ++b) {
                 if (a == b) continue;
+                if (a < b) trycount_note(&words->pair_tries, vals[a], pos[a], vals[b], pos[b]);
                 assoc_add(&words->assoc, vals[a], pos[a], vals[b], pos[b], reward);
+                if (reward > 0) note_neighbor_unlocked(words, vals[a], vals[b]);
             }
         }
+        prof_end(PROF_ASSOC, &pm);
         pthread_mutex_unlock(&words->mutex);
+
+        /* Per-executable outcome, keyed by the leading token (lock-free). */
+        exestats_record(&words->exestats, vals[0],
+                        stats ? stats->wall_s : 0.0,
+                        stats ? stats->out_bytes : 0,
+                        stats ? stats->exit_code : 0,
+                        reward, novel);
     }
 
+    intbuf_free(&local_ids);
+    if (out_novel) *out_novel = novel;
     return reward;
 }
@@ -0,0 +1,97 @@
+// src/dump.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "bufpool.h"
+#include "dump.h"
+
+static _Atomic int g_threads_override;
+
+/* =========================
+* Internal helpers
+* ========================= */
+
+typedef struct {
+    DumpFormatFn fn;
+    void        *ctx;
+    ByteBuf      buf;
+    size_t       lo, hi;
+    long         rows;     /* -1 = formatting failed */
+} DumpChunk;
+
+static void *format_chunk(void *arg) {
+    DumpChunk *c = (DumpChunk *)arg;
+    c->buf.len = 0;
+    c->rows = c->fn(&c->buf, c->lo, c->hi, c->ctx);
+    return NULL;
+}
+
+/* =========================
+* Public API
+* ========================= */
+
+int dump_threads(void) {
+    int n = atomic_load_explicit(&g_threads_override, memory_order_relaxed);
+    if (n <= 0) n = PERSIST_THREADS;
+    if (n <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        n = cpus > 0 ? (int)cpus : 1;
+    }
+    return n > MAX_THREADS ? MAX_THREADS : n;
+}
+
+void dump_set_threads(int n) {
+    atomic_store_explicit(&g_threads_override, n > 0 ? n : 0, memory_order_relaxed);
+}
+
+int dump_chunked(FILE *fp, size_t nitems, DumpFormatFn fn, void *ctx, size_t *rows) {
+    if (rows) *rows = 0;
+    if (!fp || !fn) return -1;
+    if (nitems == 0) return 0;
+
+    size_t nchunks = (nitems + PERSIST_CHUNK_ROWS - 1) / PERSIST_CHUNK_ROWS;
+    int nthreads = dump_threads();
+    if ((size_t)nthreads > nchunks) nthreads = (int)nchunks;
+
+    DumpChunk chunk[MAX_THREADS];
+    pthread_t tid[MAX_THREADS];
+    memset(chunk, 0, sizeof(chunk));
+
+    int rc = 0;
+    size_t total = 0;
+    for (size_t next = 0; next < nchunks && rc == 0; ) {
+        int k = 0;
+        for (; k < nthreads && next < nchunks; ++k, ++next) {
+            chunk[k].fn = fn;
+            chunk[k].ctx = ctx;
+            chunk[k].lo = next * PERSIST_CHUNK_ROWS;
+            chunk[k].hi = MIN(nitems, chunk[k].lo + PERSIST_CHUNK_ROWS);
+        }
+        /* chunk 0 on this thread; a failed spawn formats inline instead */
+        int started[MAX_THREADS] = { 0 };
+        for (int j = 1; j < k; ++j) {
+            started[j] = pthread_create(&tid[j], NULL, format_chunk, &chunk[j]) == 0;
+            if (!started[j]) format_chunk(&chunk[j]);
+        }
+        format_chunk(&chunk[0]);
+        for (int j = 1; j < k; ++j) if (started[j]) (void)pthread_join(tid[j], NULL);
+
+        for (int j = 0; j < k && rc == 0; ++j) {
+            if (chunk[j].rows < 0) { rc = -1; break; }
+            if (chunk[j].buf.len && fwrite(chunk[j].buf.data, 1, chunk[j].buf.len, fp) != chunk[j].buf.len) {
+                rc = -1;
+                break;
+            }
+            total += (size_t)chunk[j].rows;
+        }
+    }
+
+    for (int j = 0; j < nthreads; ++j) bytebuf_free(&chunk[j].buf);
+    if (rows) *rows = total;
+    return rc;
+}
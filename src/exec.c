@@ -9,11 +9,14 @@
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
 #include <poll.h>
 #include <time.h>
 
 #include "config.h"
 #include "exec.h"
+#include "trace.h"
+#include "memacct.h"
 
 /* ============ globals ============ */
 
@@ -40,6 +43,26 @@ static void send_signal_tree(pid_t child_pid, int sig) {
     (void)kill(-child_pid, sig);
 }
 
+static double timeval_s(struct timeval tv) {
+    return (double)tv.tv_sec + (double)tv.tv_usec / 1e6;
+}
+
+/* Non-blocking reap that also collects the child's resource usage.
+* Same return semantics as check_child_status. */
+static int reap_child(pid_t child_pid, int *status, struct rusage *ru) {
+    pid_t r = wait4(child_pid, status, WNOHANG, ru);
+    if (r == 0) return 1;
+    if (r == child_pid) return 0;
+    if (errno == EINTR) return 1;
+    return -1;
+}
+
+static int decode_exit_code(int status) {
+    if (WIFEXITED(status))   return WEXITSTATUS(status);
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return -1;
+}
+
 /* ============ public API ============ */
 
 void signal_handler(int signum) {
@@ -56,24 +79,53 @@ void signal_handler(int signum) {
 */
 int check_child_status(pid_t child_pid) {
     int status = 0;
-    pid_t r = waitpid(child_pid, &status, WNOHANG);
-    if (r == 0) {
-        return 1; /* still running */
-    } else if (r == child_pid) {
-        return 0; /* finished */
-    } else {
-        /* r < 0 */
-        if (errno == EINTR) return 1; /* treat as still running; caller will loop again */
-        return -1;
-    }
+    return reap_child(child_pid, &status, NULL);
 }
 
 char *execute_command(char cmd[]) {
+    return execute_command_stats(cmd, NULL);
+}
+
+char *execute_command_stats(char cmd[], ExecStats *stats) {
     if (!cmd) {
+        if (stats) {
+            memset(stats, 0, sizeof(*stats));
+            stats->exit_code = -1;
+        }
         errno = EINVAL;
         return NULL;
     }
+    /* Use /bin/sh -c to execute the command string */
+    char *const argv[] = { "sh", "-c", cmd, NULL };
+    return execute_argv_stats("/bin/sh", argv, stats);
+}
 
+char *execute_command_into(char cmd[], ByteBuf *out, ExecStats *stats) {
+    if (!cmd) {
+        if (stats) {
+            memset(stats, 0, sizeof(*stats));
+            stats->exit_code = -1;
+        }
+        errno = EINVAL;
+        return NULL;
+    }
+    char *const argv[] = { "sh", "-c", cmd, NULL };
+    return execute_argv_into("/bin/sh", argv, out, stats);
+}
+
+/* Run `path` with `argv`, capturing output into `out` (reused, grown as
+* needed; out->len is set). Returns out->data, or NULL on error. */
+static char *capture_argv(const char *path, char *const argv[], ByteBuf *out, ExecStats *stats) {
+    if (stats) {
+        memset(stats, 0, sizeof(*stats));
+        stats->exit_code = -1;
+    }
+    if (!path || !argv || !argv[0]) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    uint64_t tr = trace_begin();
     int pipefd[2] = {-1, -1};
     if (pipe(pipefd) != 0) {
         return NULL;
@@ -98,22 +150,21 @@ char *execute_command(char cmd[]) {
         close(pipefd[0]);
         close(pipefd[1]);
 
-        /* Use /bin/sh -c to execute the command string */
-        execl("/bin/sh", "sh", "-c", cmd, (char*)NULL);
+        execv(path, argv);
 
         /* If exec fails */
         _exit(127);
     }
 
     /* ---- parent ---- */
+    if (stats) stats->spawned = 1;
     close(pipefd[1]); /* we only read */
     set_nonblocking(pipefd[0]);
+    trace_end(TRACE_SPAWN, tr);
 
-    /* dynamic buffer to store output */
-    size_t cap = 4096;
+    /* output goes straight into the caller's buffer, EXEC_READ_CHUNK at a time */
     size_t len = 0;
-    char *buf = (char*)malloc(cap);
-    if (!buf) {
+    if (bytebuf_reserve(out, EXEC_READ_CHUNK + 1) != 0) {
         close(pipefd[0]);
         /* try to kill child if we can't buffer output */
         send_signal_tree(pid, SIGKILL);
@@ -124,40 +175,37 @@ char *execute_command(char cmd[]) {
     double t_start = now_monotonic_s();
     int kill_stage = 0; /* 0: normal, 1: sent SIGTERM, 2+: sent SIGKILLs */
     int finished = 0;
+    int wstatus = 0;
+    struct rusage ru;
+    memset(&ru, 0, sizeof(ru));
 
     struct pollfd pfd;
     pfd.fd = pipefd[0];
     pfd.events = POLLIN | POLLERR | POLLHUP;
 
-    char tmp[4096];
-
     for (;;) {
         /* Read anything available */
-        int pr = poll(&pfd, 1, 100); /* 100ms tick */
+        /* 100ms tick; after EOF the pipe would poll ready forever, so it is
+         * dropped and we only wait, briefly, for the child to exit */
+        tr = trace_begin();
+        int pr = poll(&pfd, 1, pfd.fd < 0 ? 1 : 100);
+        trace_end(TRACE_WAIT, tr);
         if (pr > 0 && (pfd.revents & (POLLIN | POLLERR | POLLHUP))) {
+            tr = trace_begin();
             for (;;) {
-                ssize_t r = read(pipefd[0], tmp, sizeof(tmp));
+                if (bytebuf_reserve(out, len + EXEC_READ_CHUNK + 1) != 0) {
+                    /* OOM; bail out */
+                    close(pipefd[0]);
+                    send_signal_tree(pid, SIGKILL);
+                    (void)waitpid(pid, NULL, 0);
+                    return NULL;
+                }
+                ssize_t r = read(pipefd[0], out->data + len, EXEC_READ_CHUNK);
                 if (r > 0) {
-                    if (len + (size_t)r + 1 > cap) {
-                        size_t ncap = cap * 2;
-                        while (ncap < len + (size_t)r + 1) ncap *= 2;
-                        char *nbuf = (char*)realloc(buf, ncap);
-                        if (!nbuf) {
-                            /* OOM; bail out */
-                            free(buf);
-                            close(pipefd[0]);
-                            send_signal_tree(pid, SIGKILL);
-                            (void)waitpid(pid, NULL, 0);
-                            return NULL;
-                        }
-                        buf = nbuf;
-                        cap = ncap;
-                    }
-                    memcpy(buf + len, tmp, (size_t)r);
                     len += (size_t)r;
-                    buf[len] = '\0';
                 } else if (r == 0) {
                     /* EOF */
+                    pfd.fd = -1;
                     break;
                 } else {
                     if (errno == EAGAIN || errno == EWOULDBLOCK) break;
@@ -165,16 +213,16 @@ char *execute_command(char cmd[]) {
                     break;
                 }
             }
+            trace_end(TRACE_CAPTURE, tr);
         }
 
         /* Check child status */
-        int cs = check_child_status(pid);
+        int cs = reap_child(pid, &wstatus, &ru);
         if (cs == 0) {
             finished = 1;
         } else if (cs < 0) {
             /* waitpid failure—terminate */
             close(pipefd[0]);
-            free(buf);
             return NULL;
         }
 
@@ -191,7 +239,6 @@ char *execute_command(char cmd[]) {
             } else {
                 /* Give up */
                 close(pipefd[0]);
-                free(buf);
                 return NULL;
             }
         }
@@ -199,21 +246,10 @@ char *execute_command(char cmd[]) {
         if (finished) {
             /* read until EOF and break */
             for (;;) {
-                ssize_t r = read(pipefd[0], tmp, sizeof(tmp));
-                if (r > 0) {
-                    if (len + (size_t)r + 1 > cap) {
-                        size_t ncap = cap * 2;
-                        while (ncap < len + (size_t)r + 1) ncap *= 2;
-                        char *nbuf = (char*)realloc(buf, ncap);
-                        if (!nbuf) break; /* best-effort; drop remainder */
-                        buf = nbuf;
-                        cap = ncap;
-                    }
-                    memcpy(buf + len, tmp, (size_t)r);
-                    len += (size_t)r;
-                } else {
-                    break;
-                }
+                if (bytebuf_reserve(out, len + EXEC_READ_CHUNK + 1) != 0) break; /* best-effort; drop remainder */
+                ssize_t r = read(pipefd[0], out->data + len, EXEC_READ_CHUNK);
+                if (r > 0) len += (size_t)r;
+                else break;
             }
             break;
         }
@@ -221,13 +257,32 @@ char *execute_command(char cmd[]) {
 
     close(pipefd[0]);
 
-    /* ensure NUL termination */
-    if (len == 0) {
-        /* return empty string instead of NULL on success */
-        buf[0] = '\0';
-    } else {
-        buf[len] = '\0';
+    /* ensure NUL termination (empty string, not NULL, on success) */
+    out->data[len] = '\0';
+    out->len = len;
+
+    if (stats) {
+        stats->wall_s    = now_monotonic_s() - t_start;
+        stats->cpu_s     = timeval_s(ru.ru_utime) + timeval_s(ru.ru_stime);
+        stats->out_bytes = len;
+        stats->exit_code = decode_exit_code(wstatus);
     }
+    return out->data;
+}
+
+char *execute_argv_into(const char *path, char *const argv[], ByteBuf *out, ExecStats *stats) {
+    if (!out) {
+        if (stats) { memset(stats, 0, sizeof(*stats)); stats->exit_code = -1; }
+        errno = EINVAL;
+        return NULL;
+    }
+    return capture_argv(path, argv, out, stats);
+}
 
-    return buf;
+char *execute_argv_stats(const char *path, char *const argv[], ExecStats *stats) {
+    ByteBuf out = {0};
+    char *res = capture_argv(path, argv, &out, stats);
+    if (!res) bytebuf_free(&out);
+    else memacct_add(MEM_BUFFERS, -(long)out.cap);   /* handed to the caller */
+    return res; /* caller owns out.data */
 }
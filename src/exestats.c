@@ -0,0 +1,197 @@
+// src/exestats.c
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "config.h"
+#include "memacct.h"
+#include "exestats.h"
+
+/* =========================
+* Internal helpers
+* ========================= */
+
+static size_t round_up_pow2(size_t x) {
+    size_t p = 1; while (p < x) p <<= 1; return p ? p : 1;
+}
+
+static size_t slot_hash(int token) {
+    uint32_t x = (uint32_t)token;
+    x ^= x >> 16; x *= 0x7feb352dU;
+    x ^= x >> 15; x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return (size_t)x;
+}
+
+static int wall_bucket(double wall_s) {
+    unsigned long ms = (unsigned long)(wall_s * 1000.0);
+    int b = 0;
+    while (ms && b < EXESTATS_HIST_BUCKETS - 1) { ms >>= 1; b++; }
+    return b;
+}
+
+/* Find the slot for `token`; claim an empty one when `create` is set. */
+static ExeStatsEntry *lookup(const ExeStats *s, int token, int create) {
+    if (!s || !s->slots || token < 0) return NULL;
+    size_t mask = s->capacity - 1;
+    size_t idx = slot_hash(token) & mask;
+    for (size_t probe = 0; probe < s->capacity; ++probe, idx = (idx + 1) & mask) {
+        ExeStatsEntry *e = &s->slots[idx];
+        int k = atomic_load_explicit(&e->key, memory_order_acquire);
+        if (k == token) return e;
+        if (k != -1) continue;
+        if (!create) return NULL;
+
+        /* keep the table at most 3/4 full so probe chains stay short */
+        ExeStats *ms = (ExeStats *)s;
+        if ((atomic_load(&ms->used) + 1) * 4 > s->capacity * 3) return NULL;
+        int expected = -1;
+        if (atomic_compare_exchange_strong(&e->key, &expected, token)) {
+            atomic_fetch_add(&ms->used, 1);
+            return e;
+        }
+        if (expected == token) return e; /* lost the race to the same key */
+    }
+    return NULL;
+}
+
+static double hist_percentile(const ExeStatsEntry *e, unsigned long runs, double q) {
+    if (runs == 0) return 0.0;
+    unsigned long want = (unsigned long)((double)runs * q + 0.5), seen = 0;
+    if (want < 1) want = 1;
+    for (int b = 0; b < EXESTATS_HIST_BUCKETS; ++b) {
+        seen += atomic_load_explicit(&e->wall_hist[b], memory_order_relaxed);
+        if (seen >= want) return (double)(1UL << b);
+    }
+    return (double)(1UL << (EXESTATS_HIST_BUCKETS - 1));
+}
+
+static void fill_view(const ExeStatsEntry *e, ExeStatsView *v) {
+    memset(v, 0, sizeof(*v));
+    v->runs       = atomic_load_explicit(&e->runs, memory_order_relaxed);
+    v->novel      = atomic_load_explicit(&e->novel, memory_order_relaxed);
+    v->failures   = atomic_load_explicit(&e->failures, memory_order_relaxed);
+    v->reward_sum = atomic_load_explicit(&e->reward_sum, memory_order_relaxed);
+    if (v->runs == 0) return;
+    double n = (double)v->runs;
+    v->mean_reward    = (double)v->reward_sum / n;
+    v->mean_wall_ms   = (double)atomic_load_explicit(&e->wall_us_sum, memory_order_relaxed) / 1000.0 / n;
+    v->mean_out_bytes = (double)atomic_load_explicit(&e->out_bytes_sum, memory_order_relaxed) / n;
+    v->p50_wall_ms    = hist_percentile(e, v->runs, 0.50);
+    v->p90_wall_ms    = hist_percentile(e, v->runs, 0.90);
+    v->p99_wall_ms    = hist_percentile(e, v->runs, 0.99);
+}
+
+/* =========================
+* Public API
+* ========================= */
+
+int exestats_init(ExeStats *s, size_t capacity_hint) {
+    if (!s) return -1;
+    size_t cap = round_up_pow2(capacity_hint ? capacity_hint : EXESTATS_CAPACITY);
+    s->slots = (ExeStatsEntry *)calloc(cap, sizeof(*s->slots));
+    if (!s->slots) { s->capacity = 0; return -1; }
+    memacct_add(MEM_TABLES, (long)(cap * sizeof(*s->slots)));
+    for (size_t i = 0; i < cap; ++i) atomic_init(&s->slots[i].key, -1);
+    s->capacity = cap;
+    atomic_init(&s->used, 0);
+    atomic_init(&s->dropped, 0);
+    return 0;
+}
+
+void exestats_free(ExeStats *s) {
+    if (!s) return;
+    memacct_add(MEM_TABLES, -(long)(s->capacity * sizeof(*s->slots)));
+    free(s->slots);
+    s->slots = NULL;
+    s->capacity = 0;
+}
+
+void exestats_record(ExeStats *s, int token,
+                     double wall_s, size_t out_bytes, int exit_code,
+                     int reward, int novel) {
+    ExeStatsEntry *e = lookup(s, token, 1);
+    if (!e) {
+        if (s && s->slots) atomic_fetch_add_explicit(&s->dropped, 1, memory_order_relaxed);
+        return;
+    }
+    atomic_fetch_add_explicit(&e->runs, 1, memory_order_relaxed);
+    if (novel)          atomic_fetch_add_explicit(&e->novel, 1, memory_order_relaxed);
+    if (exit_code != 0) atomic_fetch_add_explicit(&e->failures, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&e->reward_sum, reward, memory_order_relaxed);
+    atomic_fetch_add_explicit(&e->wall_us_sum, (unsigned long)(wall_s * 1e6), memory_order_relaxed);
+    atomic_fetch_add_explicit(&e->out_bytes_sum, (unsigned long)out_bytes, memory_order_relaxed);
+    atomic_fetch_add_explicit(&e->wall_hist[wall_bucket(wall_s)], 1, memory_order_relaxed);
+}
+
+int exestats_get(const ExeStats *s, int token, ExeStatsView *out) {
+    ExeStatsEntry *e = lookup(s, token, 0);
+    if (!e) return 0;
+    if (out) fill_view(e, out);
+    return 1;
+}
+
+double exestats_first_score(const ExeStats *s, int token, int *dead) {
+    const double prior = (double)REWARD / 2.0;
+    if (dead) *dead = 0;
+    ExeStatsEntry *e = lookup(s, token, 0);
+    if (!e) return prior;
+
+    unsigned long runs  = atomic_load_explicit(&e->runs, memory_order_relaxed);
+    unsigned long novel = atomic_load_explicit(&e->novel, memory_order_relaxed);
+    unsigned long fails = atomic_load_explicit(&e->failures, memory_order_relaxed);
+    long rsum = atomic_load_explicit(&e->reward_sum, memory_order_relaxed);
+
+    if (dead && runs >= EXESTATS_DEAD_RUNS && novel == 0 && fails >= runs) *dead = 1;
+    return ((double)rsum + prior * EXESTATS_PRIOR_RUNS) / ((double)runs + EXESTATS_PRIOR_RUNS);
+}
+
+int exestats_next_counts(const ExeStats *s, size_t *cursor, int *token, ExeStatsCounts *out) {
+    if (!s || !s->slots || !cursor) return 0;
+    while (*cursor < s->capacity) {
+        const ExeStatsEntry *e = &s->slots[(*cursor)++];
+        int k = atomic_load_explicit(&e->key, memory_order_acquire);
+        if (k < 0) continue;
+        if (token) *token = k;
+        if (out) {
+            out->runs          = atomic_load_explicit(&e->runs, memory_order_relaxed);
+            out->novel         = atomic_load_explicit(&e->novel, memory_order_relaxed);
+            out->failures      = atomic_load_explicit(&e->failures, memory_order_relaxed);
+            out->reward_sum    = atomic_load_explicit(&e->reward_sum, memory_order_relaxed);
+            out->wall_us_sum   = atomic_load_explicit(&e->wall_us_sum, memory_order_relaxed);
+            out->out_bytes_sum = atomic_load_explicit(&e->out_bytes_sum, memory_order_relaxed);
+            for (int b = 0; b < EXESTATS_HIST_BUCKETS; ++b)
+                out->wall_hist[b] = atomic_load_explicit(&e->wall_hist[b], memory_order_relaxed);
+        }
+        return 1;
+    }
+    return 0;
+}
+
+int exestats_add_counts(ExeStats *s, int token, const ExeStatsCounts *c) {
+    if (!c) return -1;
+    ExeStatsEntry *e = lookup(s, token, 1);
+    if (!e) return -1;
+    atomic_fetch_add_explicit(&e->runs, c->runs, memory_order_relaxed);
+    atomic_fetch_add_explicit(&e->novel, c->novel, memory_order_relaxed);
+    atomic_fetch_add_explicit(&e->failures, c->failures, memory_order_relaxed);
+    atomic_fetch_add_explicit(&e->reward_sum, c->reward_sum, memory_order_relaxed);
+    atomic_fetch_add_explicit(&e->wall_us_sum, c->wall_us_sum, memory_order_relaxed);
+    atomic_fetch_add_explicit(&e->out_bytes_sum, c->out_bytes_sum, memory_order_relaxed);
+    for (int b = 0; b < EXESTATS_HIST_BUCKETS; ++b)
+        atomic_fetch_add_explicit(&e->wall_hist[b], c->wall_hist[b], memory_order_relaxed);
+    return 0;
+}
+
+int exestats_next(const ExeStats *s, size_t *cursor, int *token, ExeStatsView *out) {
+    if (!s || !s->slots || !cursor) return 0;
+    while (*cursor < s->capacity) {
+        const ExeStatsEntry *e = &s->slots[(*cursor)++];
+        int k = atomic_load_explicit(&e->key, memory_order_acquire);
+        if (k < 0) continue;
+        if (token) *token = k;
+        if (out) fill_view(e, out);
+        return 1;
+    }
+    return 0;
+}
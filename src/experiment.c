@@ -0,0 +1,217 @@
+// src/experiment.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "config.h"
+#include "model.h"
+#include "experiment.h"
+
+/* Two-sided 95% Student t quantiles for 1..30 degrees of freedom. */
+static const double k_t975[30] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+};
+
+/* A rate (novel per wall or CPU second) with its standard error. */
+typedef struct {
+    double rate, se, df;
+    int    ok;   /* at least two batches */
+} RateEst;
+
+/* =========================
+* Internal helpers
+* ========================= */
+
+static double t975(double df) {
+    if (df < 1.0) return k_t975[0];
+    if (df <= 30.0) return k_t975[(int)df - 1];
+    return 1.96 + 2.5 / df;
+}
+
+/* Ratio estimator R = sum(novel) / sum(x) over the batches, with its
+ * linearized standard error; x is each batch's wall or CPU seconds. */
+static RateEst rate_of(const ExpArm *a, int use_cpu) {
+    RateEst r = { 0.0, 0.0, 0.0, 0 };
+    double sn = 0.0, sx = 0.0;
+    for (size_t b = 0; b < a->nbatch; ++b) {
+        sn += a->batch[b].novel;
+        sx += use_cpu ? a->batch[b].cpu_s : a->batch[b].wall_s;
+    }
+    if (sx <= 0.0) return r;
+    r.rate = sn / sx;
+    size_t n = a->nbatch;
+    if (n < 2) return r;
+    double ss = 0.0, xbar = sx / (double)n;
+    for (size_t b = 0; b < n; ++b) {
+        double x = use_cpu ? a->batch[b].cpu_s : a->batch[b].wall_s;
+        double d = a->batch[b].novel - r.rate * x;
+        ss += d * d;
+    }
+    r.se = sqrt(ss / ((double)n * (double)(n - 1))) / xbar;
+    r.df = (double)(n - 1);
+    r.ok = 1;
+    return r;
+}
+
+static void push_batch(ExpArm *a, const ExpBatch *b) {
+    pthread_mutex_lock(&a->mutex);
+    if (a->nbatch == a->cap) {
+        size_t nc = a->cap ? a->cap * 2 : 64;
+        ExpBatch *nb = (ExpBatch *)realloc(a->batch, nc * sizeof(*nb));
+        if (nb) { a->batch = nb; a->cap = nc; }
+    }
+    if (a->nbatch < a->cap) a->batch[a->nbatch++] = *b;
+    pthread_mutex_unlock(&a->mutex);
+}
+
+static int parse_override(CommandSettings *s, int *fixed_length, const char *key, const char *val) {
+    char *end;
+    double v = strtod(val, &end);
+    if (end == val || *end != '\0') return -1;
+    if (!strcmp(key, "explore"))     s->explore = v > 0.0 ? v : 0.0;
+    else if (!strcmp(key, "budget")) s->budget_us = v > 0.0 ? (int)v : 0;
+    else if (!strcmp(key, "scope"))  s->scope = CLAMP((int)v, SRCHMIN, SRCHMAX);
+    else if (!strcmp(key, "length")) { s->length = CLAMP((int)v, CMDMIN, CMDMAX); *fixed_length = 1; }
+    else return -1;
+    return 0;
+}
+
+static void format_ci(char *buf, size_t n, const RateEst *r) {
+    if (!r->ok) { snprintf(buf, n, "%.3f", r->rate); return; }
+    double h = t975(r->df) * r->se;
+    snprintf(buf, n, "%.3f [%.3f, %.3f]", r->rate, r->rate - h, r->rate + h);
+}
+
+/* Difference b - a with a Welch (Satterthwaite) interval. */
+static void format_diff(char *buf, size_t n, const RateEst *a, const RateEst *b) {
+    double d = b->rate - a->rate;
+    if (!a->ok || !b->ok) { snprintf(buf, n, "%+.3f", d); return; }
+    double va = a->se * a->se, vb = b->se * b->se, v = va + vb;
+    double df = v > 0.0 ? v * v / (va * va / a->df + vb * vb / b->df) : 1.0;
+    double h = t975(df) * sqrt(v);
+    snprintf(buf, n, "%+.3f [%+.3f, %+.3f]", d, d - h, d + h);
+}
+
+/* =========================
+* Public API
+* ========================= */
+
+void experiment_init(Experiment *e) {
+    if (!e) return;
+    memset(e, 0, sizeof(*e));
+}
+
+void experiment_free(Experiment *e) {
+    if (!e) return;
+    for (int i = 0; i < e->narms; ++i) {
+        free(e->arm[i].batch);
+        pthread_mutex_destroy(&e->arm[i].mutex);
+        pthread_mutex_destroy(&e->arm[i].settings.mutex);
+    }
+    e->narms = 0;
+}
+
+int experiment_add_arm(Experiment *e, const char *spec, const CommandSettings *base) {
+    if (!e || !spec || !base) return -1;
+    if (e->narms >= EXPERIMENT_MAX_ARMS) {
+        fprintf(stderr, "[experiment] at most %d arms; ignoring '%s'\n", EXPERIMENT_MAX_ARMS, spec);
+        return -1;
+    }
+    ExpArm *a = &e->arm[e->narms];
+    memset(a, 0, sizeof(*a));
+    a->settings.length    = base->length;
+    a->settings.scope     = base->scope;
+    a->settings.budget_us = base->budget_us;
+    a->settings.explore   = base->explore;
+
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", spec);
+    char *save = NULL;
+    for (char *kv = strtok_r(buf, ",", &save); kv; kv = strtok_r(NULL, ",", &save)) {
+        char *eq = strchr(kv, '=');
+        if (eq) *eq = '\0';
+        if (!eq || parse_override(&a->settings, &a->fixed_length, kv, eq + 1) != 0) {
+            fprintf(stderr, "[experiment] bad arm '%s' (want explore=C,budget=US,scope=P,length=N)\n", spec);
+            return -1;
+        }
+    }
+    snprintf(a->name, sizeof(a->name), "%s", *spec ? spec : "base");
+    if (pthread_mutex_init(&a->settings.mutex, NULL) != 0) return -1;
+    if (pthread_mutex_init(&a->mutex, NULL) != 0) {
+        pthread_mutex_destroy(&a->settings.mutex);
+        return -1;
+    }
+    return e->narms++;
+}
+
+int experiment_assign(Experiment *e, int worker_id) {
+    if (!e || e->narms <= 0) return -1;
+    int arm = worker_id % e->narms;
+    e->arm[arm].workers++;
+    return arm;
+}
+
+void experiment_note(Experiment *e, int arm, ExpBatch *acc, int novel, double wall_s, double cpu_s) {
+    if (!e || arm < 0 || arm >= e->narms || !acc) return;
+    acc->runs++;
+    acc->novel  += novel;
+    acc->wall_s += wall_s;
+    acc->cpu_s  += cpu_s;
+    if (acc->wall_s >= EXPERIMENT_BATCH_S) experiment_flush(e, arm, acc);
+}
+
+void experiment_flush(Experiment *e, int arm, ExpBatch *acc) {
+    if (!e || arm < 0 || arm >= e->narms || !acc || acc->runs == 0) return;
+    push_batch(&e->arm[arm], acc);
+    memset(acc, 0, sizeof(*acc));
+}
+
+void experiment_follow_length(Experiment *e, int length) {
+    if (!e) return;
+    for (int i = 0; i < e->narms; ++i) {
+        ExpArm *a = &e->arm[i];
+        if (a->fixed_length) continue;
+        pthread_mutex_lock(&a->settings.mutex);
+        a->settings.length = CLAMP(length, CMDMIN, CMDMAX);
+        pthread_mutex_unlock(&a->settings.mutex);
+    }
+}
+
+void experiment_report(Experiment *e, FILE *fp) {
+    if (!e || e->narms <= 0 || !fp) return;
+    RateEst wall[EXPERIMENT_MAX_ARMS], cpu[EXPERIMENT_MAX_ARMS];
+    fprintf(fp, "[experiment] %-3s %-24s %3s %7s %6s %5s %9s %8s  %-26s %s\n",
+            "arm", "settings", "wrk", "runs", "novel", "batch", "worker-s", "cpu-s",
+            "new/worker-s [95% CI]", "new/cpu-s [95% CI]");
+    for (int i = 0; i < e->narms; ++i) {
+        ExpArm *a = &e->arm[i];
+        pthread_mutex_lock(&a->mutex);
+        ExpBatch tot = { 0, 0.0, 0.0, 0.0 };
+        for (size_t b = 0; b < a->nbatch; ++b) {
+            tot.runs   += a->batch[b].runs;
+            tot.novel  += a->batch[b].novel;
+            tot.wall_s += a->batch[b].wall_s;
+            tot.cpu_s  += a->batch[b].cpu_s;
+        }
+        wall[i] = rate_of(a, 0);
+        cpu[i]  = rate_of(a, 1);
+        size_t nbatch = a->nbatch;
+        pthread_mutex_unlock(&a->mutex);
+
+        char wbuf[48], cbuf[48];
+        format_ci(wbuf, sizeof(wbuf), &wall[i]);
+        format_ci(cbuf, sizeof(cbuf), &cpu[i]);
+        fprintf(fp, "[experiment] %-3c %-24s %3d %7lu %6.0f %5zu %9.1f %8.2f  %-26s %s\n",
+                'A' + i, a->name, a->workers, tot.runs, tot.novel, nbatch,
+                tot.wall_s, tot.cpu_s, wbuf, cbuf);
+    }
+    for (int i = 1; i < e->narms; ++i) {
+        char wbuf[64], cbuf[64];
+        format_diff(wbuf, sizeof(wbuf), &wall[0], &wall[i]);
+        format_diff(cbuf, sizeof(cbuf), &cpu[0], &cpu[i]);
+        fprintf(fp, "[experiment] %c - A: new/worker-s %s, new/cpu-s %s\n", 'A' + i, wbuf, cbuf);
+    }
+}
@@ -0,0 +1,53 @@
+// src/inflight.c
+#include <stdatomic.h>
+
+#include "config.h"
+#include "inflight.h"
+
+static _Atomic unsigned long g_avoided;
+static _Atomic unsigned long g_gave_up;
+
+/* =========================
+* Public API
+* ========================= */
+
+void inflight_init(InFlight *f) {
+    if (!f) return;
+    for (int i = 0; i < MAX_THREADS; ++i) atomic_init(&f->slot[i].key, 0ULL);
+}
+
+unsigned long long inflight_key(const int cmd[CMDMAX + 1]) {
+    unsigned long long h = 0x9e3779b97f4a7c15ULL;
+    for (int i = 0; i < CMDMAX && cmd[i] != IDX_TERMINATOR; ++i) {
+        h ^= (unsigned long long)(unsigned int)cmd[i] + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+        h *= 0xff51afd7ed558ccdULL;
+    }
+    h ^= h >> 33;
+    return h ? h : 1;
+}
+
+int inflight_claim(InFlight *f, int worker, unsigned long long key) {
+    if (!f || worker < 0 || worker >= MAX_THREADS) return 1;
+    atomic_store(&f->slot[worker].key, key);
+    for (int i = 0; i < MAX_THREADS; ++i) {
+        if (i == worker || atomic_load(&f->slot[i].key) != key) continue;
+        atomic_store_explicit(&f->slot[worker].key, 0ULL, memory_order_release);
+        atomic_fetch_add_explicit(&g_avoided, 1, memory_order_relaxed);
+        return 0;
+    }
+    return 1;
+}
+
+void inflight_release(InFlight *f, int worker) {
+    if (!f || worker < 0 || worker >= MAX_THREADS) return;
+    atomic_store_explicit(&f->slot[worker].key, 0ULL, memory_order_release);
+}
+
+void inflight_note_gave_up(void) {
+    atomic_fetch_add_explicit(&g_gave_up, 1, memory_order_relaxed);
+}
+
+void inflight_counts(unsigned long *avoided, unsigned long *gave_up) {
+    if (avoided) *avoided = atomic_load_explicit(&g_avoided, memory_order_relaxed);
+    if (gave_up) *gave_up = atomic_load_explicit(&g_gave_up, memory_order_relaxed);
+}
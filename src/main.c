@@ -10,17 +10,42 @@
 #include "database.h"
 #include "trend.h"
 #include "threads.h"
+#include "stats.h"
+#include "bench.h"
+#include "soak.h"
+#include "normalize.h"
+#include "prof.h"
+#include "trace.h"
+#include "state.h"
+#include "experiment.h"
+#include "memacct.h"
 #include "exec.h"     // signal_handler, termination_requested
 
 static void usage(const char *prog) {
     fprintf(stderr,
-            "Usage: %s [--threads N] [--length N] [--scope P]\n"
+            "Usage: %s [--threads N] [--length N] [--scope P] [--budget-us N] [--explore C] [--arm SPEC]... [--normalize 0|1] [--profile] [--trace FILE] [--bench] [--soak S]\n"
             "  --threads N   Number of worker threads (1..%d) [default: %d]\n"
-            "  --length  N   Command arg length (%d..%d) [default: %d]\n"
-            "  --scope   P   Vocabulary sampling scope (percent %d..%d) [default: %d]\n",
+            "  --length  N   Command arg length (%d..%d) [default: %d, or as last tuned]\n"
+            "  --scope   P   Vocabulary sampling scope (percent %d..%d) [default: %d]\n"
+            "  --budget-us N Per-command construction budget, 0 = score whole scope [default: %d]\n"
+            "  --explore  C  Novelty bonus weight for rarely tried tokens, 0 = off [default: %.1f]\n"
+            "  --arm SPEC    A/B mode: add an arm, e.g. explore=0,budget=0,scope=30,length=2; workers\n"
+            "                are dealt to arms round-robin and compared at shutdown (max %d arms)\n"
+            "  --normalize B Map numbers/hex/paths/times in output to classes [default: %d]\n"
+            "  --profile     Report per-stage time and hardware counters at shutdown\n"
+            "  --trace F     Record pipeline spans; write Chrome trace JSON to F at exit and on SIGUSR1\n"
+            "  --bench       Run the built-in micro-benchmarks and exit\n"
+            "  --soak S      Run S simulated seconds against a fake executor, report scaling, and exit;\n"
+            "                one thread, construct and update only (no spawns, in-flight dedup or\n"
+            "                tuner); length %d unless --length is given\n",
             prog, MAX_THREADS, MAX_THREADS,
             CMDMIN, CMDMAX, 1,
-            SRCHMIN, SRCHMAX, 50);
+            SRCHMIN, SRCHMAX, 50,
+            CONSTRUCT_BUDGET_US,
+            EXPLORE_UCB_C,
+            EXPERIMENT_MAX_ARMS,
+            NORMALIZE_OUTPUT,
+            SOAK_LENGTH);
 }
 
 static void install_handlers(void) {
@@ -30,6 +55,10 @@ static void install_handlers(void) {
     sa.sa_flags = 0;                // set SA_RESTART if you prefer auto-restarting syscalls
     if (sigaction(SIGINT,  &sa, NULL) == -1) perror("sigaction(SIGINT)");
     if (sigaction(SIGTERM, &sa, NULL) == -1) perror("sigaction(SIGTERM)");
+    if (trace_enabled()) {
+        sa.sa_handler = trace_signal_handler;   // dump the trace rings on demand
+        if (sigaction(SIGUSR1, &sa, NULL) == -1) perror("sigaction(SIGUSR1)");
+    }
     // Optional: ignore SIGPIPE so writes to closed pipes don't kill the process
     signal(SIGPIPE, SIG_IGN);
 }
@@ -37,7 +66,13 @@ static void install_handlers(void) {
 int main(int argc, char **argv) {
     int num_threads = MAX_THREADS;
     int want_length = 1;   // start simple: executable only
+    int have_length = 0;   // --length given: overrides the saved tuner state
     int want_scope  = 50;
+    int want_budget = CONSTRUCT_BUDGET_US;
+    double want_explore = EXPLORE_UCB_C;
+    double soak_seconds = 0.0;
+    const char *arm_specs[EXPERIMENT_MAX_ARMS];
+    int num_arms = 0;
 
     // --- CLI parsing
     for (int i = 1; i < argc; ++i) {
@@ -45,8 +80,30 @@ int main(int argc, char **argv) {
             num_threads = atoi(argv[++i]);
         } else if (!strcmp(argv[i], "--length") && i + 1 < argc) {
             want_length = atoi(argv[++i]);
+            have_length = 1;
         } else if (!strcmp(argv[i], "--scope") && i + 1 < argc) {
             want_scope = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--budget-us") && i + 1 < argc) {
+            want_budget = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--explore") && i + 1 < argc) {
+            want_explore = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--arm") && i + 1 < argc) {
+            if (num_arms >= EXPERIMENT_MAX_ARMS) {
+                fprintf(stderr, "Too many --arm options (max %d)\n", EXPERIMENT_MAX_ARMS);
+                usage(argv[0]);
+                return 1;
+            }
+            arm_specs[num_arms++] = argv[++i];
+        } else if (!strcmp(argv[i], "--normalize") && i + 1 < argc) {
+            set_output_normalization(atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--trace") && i + 1 < argc) {
+            trace_enable(argv[++i]);
+        } else if (!strcmp(argv[i], "--profile")) {
+            prof_enable(1);
+        } else if (!strcmp(argv[i], "--soak") && i + 1 < argc) {
+            soak_seconds = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--bench")) {
+            return run_benchmarks(stdout) == 0 ? 0 : 1;
         } else if (!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help")) {
             usage(argv[0]);
             return 0;
@@ -64,10 +121,22 @@ int main(int argc, char **argv) {
     if (want_length > CMDMAX) want_length = CMDMAX;
     if (want_scope < SRCHMIN) want_scope = SRCHMIN;
     if (want_scope > SRCHMAX) want_scope = SRCHMAX;
+    if (want_budget < 0) want_budget = 0;
+    if (!(want_explore > 0.0)) want_explore = 0.0;
 
     // --- Signals first
     install_handlers();
 
+    if (soak_seconds > 0.0) {
+        CommandSettings soak_settings = {
+            .length = have_length ? want_length : SOAK_LENGTH, .scope = want_scope,
+            .budget_us = want_budget, .explore = want_explore,
+        };
+        int rc = run_soak(stdout, soak_seconds, &soak_settings);
+        prof_thread_exit();
+        return rc;
+    }
+
     // --- Core models
     Words words;
     Observations observations;
@@ -77,8 +146,13 @@ int main(int argc, char **argv) {
     init_words(&words);
     init_observations(&observations);
 
+    // Older observation lines live in mapped segments; only recent ones stay in memory
+    if (OBS_HOT_ROWS > 0 && attach_observation_segments(&observations, OBS_SEGMENT_DIR) != 0) {
+        fprintf(stderr, "[warn] observation segments unavailable; keeping every line in memory.\n");
+    }
+
     // Load DB if present
-    if (load_database(&words, &observations, NULL, NULL, NULL) != 0) {
+    if (load_database(&words, &observations, TOKENS_FILE, VALUES_FILE, OBSERVATIONS_FILE) != 0) {
         fprintf(stderr, "[warn] load_database failed; starting with empty DB.\n");
     }
 
@@ -92,6 +166,8 @@ int main(int argc, char **argv) {
     // Settings
     settings.length = want_length;
     settings.scope  = want_scope;
+    settings.budget_us = want_budget;
+    settings.explore   = want_explore;
     if (pthread_mutex_init(&settings.mutex, NULL) != 0) {
         fprintf(stderr, "Failed to init settings.mutex\n");
         cleanup_database(&words, &observations);
@@ -101,10 +177,38 @@ int main(int argc, char **argv) {
     // Trend tracker
     init_trend_tracker(&tracker);
 
+    // Warm restart: tuned length, trend and exploration/executable stats
+    (void)load_state(&words, &settings, &tracker, STATE_FILE);
+    if (have_length) settings.length = want_length;
+
+    // PATH resolution cache for leading tokens (NULL pathcache = shell only)
+    PathCache pathcache;
+    int have_pathcache = (pathcache_init(&pathcache, NULL) == 0);
+
+    // A/B arms, each with its own copy of the settings
+    Experiment experiment;
+    experiment_init(&experiment);
+    for (int a = 0; a < num_arms; ++a) {
+        if (experiment_add_arm(&experiment, arm_specs[a], &settings) >= 0) continue;
+        usage(argv[0]);
+        destroy_trend_tracker(&tracker);
+        if (have_pathcache) pathcache_free(&pathcache);
+        experiment_free(&experiment);
+        pthread_mutex_destroy(&settings.mutex);
+        cleanup_database(&words, &observations);
+        return 1;
+    }
+
+    // Commands currently running, so workers don't fork the same one twice
+    InFlight inflight;
+    inflight_init(&inflight);
+
     // Concurrency gate
     if (init_thread_sem((unsigned int)num_threads) != 0) {
         fprintf(stderr, "Failed to initialize thread semaphore\n");
         destroy_trend_tracker(&tracker);
+        if (have_pathcache) pathcache_free(&pathcache);
+        experiment_free(&experiment);
         pthread_mutex_destroy(&settings.mutex);
         cleanup_database(&words, &observations);
         return 1;
@@ -114,8 +218,8 @@ int main(int argc, char **argv) {
     pthread_t  tids[MAX_THREADS];
     ThreadData payloads[MAX_THREADS];
 
-    printf("Launching %d worker thread(s) (length=%d, scope=%d%%)\n",
-           num_threads, want_length, want_scope);
+    printf("Launching %d worker thread(s) (length=%d, scope=%d%%, budget=%dus, explore=%.1f)\n",
+           num_threads, settings.length, want_scope, want_budget, want_explore);
     printf("Press Ctrl-C to stop.\n");
 
     for (int i = 0; i < num_threads; ++i) {
@@ -123,6 +227,16 @@ int main(int argc, char **argv) {
         payloads[i].observations = &observations;
         payloads[i].settings     = &settings;
         payloads[i].tracker      = &tracker;
+        payloads[i].pathcache    = have_pathcache ? &pathcache : NULL;
+        payloads[i].inflight     = INFLIGHT_DEDUP ? &inflight : NULL;
+        payloads[i].worker_id    = i;
+        payloads[i].experiment   = NULL;
+        payloads[i].arm          = -1;
+        if (experiment.narms > 0) {
+            payloads[i].experiment = &experiment;
+            payloads[i].arm        = experiment_assign(&experiment, i);
+            payloads[i].settings   = &experiment.arm[payloads[i].arm].settings;
+        }
 
         int rc = pthread_create(&tids[i], NULL, worker_thread, &payloads[i]);
         if (rc != 0) {
@@ -132,12 +246,20 @@ int main(int argc, char **argv) {
         }
     }
 
-    // --- Spawn tuner (periodically adjusts settings->length)
+    for (int a = 0; a < experiment.narms; ++a) {
+        const ExpArm *arm = &experiment.arm[a];
+        printf("[experiment] arm %c: %s -> %d worker(s), length=%d%s, scope=%d%%, budget=%dus, explore=%.1f\n",
+               'A' + a, arm->name, arm->workers, arm->settings.length, arm->fixed_length ? "" : " (tuned)",
+               arm->settings.scope, arm->settings.budget_us, arm->settings.explore);
+        if (arm->workers == 0) printf("[experiment] arm %c has no workers; use --threads >= %d\n", 'A' + a, experiment.narms);
+    }
+
+    // --- Spawn tuner (adjusts settings->length whenever the tracker signals)
     pthread_t tuner_tid;
     TunerArgs tuner_args = {
         .settings    = &settings,
         .tracker     = &tracker,
-        .interval_ms = 1500,    // tweak if you want faster/slower adjustments
+        .experiment  = experiment.narms > 0 ? &experiment : NULL,
     };
     if (pthread_create(&tuner_tid, NULL, tuner_thread, &tuner_args) != 0) {
         fprintf(stderr, "[warn] failed to start tuner thread; continuing without tuning\n");
@@ -149,7 +271,8 @@ int main(int argc, char **argv) {
         (void)pthread_join(tids[i], NULL);
     }
 
-    // Stop & join tuner if it started
+    // Wake & join tuner if it started
+    shutdown_trend_tracker(&tracker);
     if (tuner_tid) {
         (void)pthread_join(tuner_tid, NULL);
     }
@@ -160,6 +283,8 @@ int main(int argc, char **argv) {
 
     // Persist DB
     write_database(&words, &observations, TOKENS_FILE, VALUES_FILE, OBSERVATIONS_FILE);
+    (void)write_state(&words, &settings, &tracker, STATE_FILE);
+    (void)trace_write();
 
     // Trend summary
     double ma = get_moving_average(&tracker);
@@ -167,11 +292,33 @@ int main(int argc, char **argv) {
     const char *tstr = (trend > 0) ? "up" : (trend < 0) ? "down" : "flat";
     printf("Learning moving average: %.2f  (trend: %s)\n", ma, tstr);
 
+    TrendSnapshot snap;
+    get_trend_snapshot(&tracker, &snap);
+    printf("Learning EWMA:");
+    for (int e = 0; e < TREND_EWMA_COUNT; ++e) printf(" %.2f", snap.ewma[e]);
+    printf("  over %ld sample(s)\n", snap.samples);
+    for (int w = 0; w < TREND_TIME_WINDOW_COUNT; ++w) {
+        printf("  last %3ds: %.1f cmd/s, mean lrn %.2f\n",
+               snap.window_s[w], snap.window_rate[w], snap.window_mean[w]);
+    }
+
+    print_stats_report(stdout, &words, &observations);
+    experiment_report(&experiment, stdout);
+    if (have_pathcache) {
+        printf("[stats] PATH cache: %lu hit(s), %lu miss(es), %lu invalidation(s)\n",
+               pathcache.hits, pathcache.misses, pathcache.invalidations);
+    }
+
     // Teardown
+    prof_thread_exit();
+    trace_free();
     destroy_thread_sem();
     destroy_trend_tracker(&tracker);
+    if (have_pathcache) pathcache_free(&pathcache);
+    experiment_free(&experiment);
     pthread_mutex_destroy(&settings.mutex);
     cleanup_database(&words, &observations);
+    (void)memacct_check_released(stderr);
 
     printf("Shutdown complete.\n");
     return 0;
@@ -0,0 +1,99 @@
+// src/memacct.c
+#include <stdio.h>
+#include <stdatomic.h>
+
+#include "config.h"
+#include "memacct.h"
+
+static const char *const k_names[MEM_KINDS] = {
+    "tokens", "token meta", "lookup", "assoc entries", "assoc index",
+    "obs rows", "obs index", "buffers", "tables",
+};
+
+static _Atomic long g_live[MEM_KINDS];
+static _Atomic long g_peak[MEM_KINDS];
+static _Atomic long g_total_live;
+static _Atomic long g_total_peak;
+static atomic_int   g_over_budget;
+
+/* =========================
+* Internal helpers
+* ========================= */
+
+static void raise_peak(_Atomic long *peak, long v) {
+    long p = atomic_load_explicit(peak, memory_order_relaxed);
+    while (v > p && !atomic_compare_exchange_weak_explicit(peak, &p, v,
+                                                           memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+static double mib(long b) {
+    return (double)b / (1024.0 * 1024.0);
+}
+
+/* =========================
+* Public API
+* ========================= */
+
+void memacct_add(MemKind kind, long delta) {
+    if (kind < 0 || kind >= MEM_KINDS || delta == 0) return;
+    long v = atomic_fetch_add_explicit(&g_live[kind], delta, memory_order_relaxed) + delta;
+    long t = atomic_fetch_add_explicit(&g_total_live, delta, memory_order_relaxed) + delta;
+    if (delta < 0) return;
+    raise_peak(&g_peak[kind], v);
+    raise_peak(&g_total_peak, t);
+#if MEMORY_BUDGET_MB > 0
+    if (t > (long)MEMORY_BUDGET_MB * 1024L * 1024L &&
+        !atomic_exchange_explicit(&g_over_budget, 1, memory_order_relaxed)) {
+        fprintf(stderr, "[mem] live model memory %.1f MiB is over MEMORY_BUDGET_MB (%d)\n",
+                mib(t), MEMORY_BUDGET_MB);
+    }
+#endif
+}
+
+void memacct_get(MemKind kind, size_t *live, size_t *peak) {
+    long l = 0, p = 0;
+    if (kind >= 0 && kind < MEM_KINDS) {
+        l = atomic_load_explicit(&g_live[kind], memory_order_relaxed);
+        p = atomic_load_explicit(&g_peak[kind], memory_order_relaxed);
+    }
+    if (live) *live = l > 0 ? (size_t)l : 0;
+    if (peak) *peak = p > 0 ? (size_t)p : 0;
+}
+
+void memacct_total(size_t *live, size_t *peak) {
+    long l = atomic_load_explicit(&g_total_live, memory_order_relaxed);
+    long p = atomic_load_explicit(&g_total_peak, memory_order_relaxed);
+    if (live) *live = l > 0 ? (size_t)l : 0;
+    if (peak) *peak = p > 0 ? (size_t)p : 0;
+}
+
+const char *memacct_name(MemKind kind) {
+    return (kind >= 0 && kind < MEM_KINDS) ? k_names[kind] : "?";
+}
+
+void memacct_report(FILE *fp) {
+    if (!fp) return;
+    long total = atomic_load_explicit(&g_total_live, memory_order_relaxed);
+    fprintf(fp, "[stats] memory: %.1f MiB live, %.1f MiB peak (requested bytes; budget %s)\n",
+            mib(total), mib(atomic_load_explicit(&g_total_peak, memory_order_relaxed)),
+            MEMORY_BUDGET_MB > 0 ? (atomic_load(&g_over_budget) ? "exceeded" : "ok") : "off");
+    fprintf(fp, "    %-14s %10s %10s %6s\n", "structure", "live KiB", "peak KiB", "share");
+    for (int k = 0; k < MEM_KINDS; ++k) {
+        long l = atomic_load_explicit(&g_live[k], memory_order_relaxed);
+        long p = atomic_load_explicit(&g_peak[k], memory_order_relaxed);
+        fprintf(fp, "    %-14s %10.1f %10.1f %5.1f%%\n", k_names[k], (double)l / 1024.0, (double)p / 1024.0,
+                total > 0 ? 100.0 * (double)l / (double)total : 0.0);
+    }
+}
+
+size_t memacct_check_released(FILE *fp) {
+    size_t total = 0;
+    for (int k = 0; k < MEM_KINDS; ++k) {
+        long l = atomic_load_explicit(&g_live[k], memory_order_relaxed);
+        if (l == 0) continue;
+        if (fp) fprintf(fp, "[mem] %s: %ld byte(s) still accounted after teardown\n", k_names[k], l);
+        total += l > 0 ? (size_t)l : (size_t)-l;
+    }
+    return total;
+}
@@ -0,0 +1,125 @@
+// src/normalize.c
+#include <stdatomic.h>
+
+#include "config.h"
+#include "normalize.h"
+
+/* =========================
+* Character classes
+* ========================= */
+
+enum {
+    C_DIGIT = 1 << 0,
+    C_HEXA  = 1 << 1,   /* a-f A-F */
+    C_SIGN  = 1 << 2,   /* + - */
+    C_DOT   = 1 << 3,   /* . , */
+    C_COLON = 1 << 4,
+    C_DATE  = 1 << 5,   /* T Z / (date/time separators) */
+    C_UNIT  = 1 << 6,   /* size/percent suffixes */
+    C_HEXP  = 1 << 7,   /* x X (only valid in a 0x prefix) */
+};
+
+#define D C_DIGIT
+#define H C_HEXA
+static const unsigned char cc[256] = {
+    ['0'] = D, ['1'] = D, ['2'] = D, ['3'] = D, ['4'] = D,
+    ['5'] = D, ['6'] = D, ['7'] = D, ['8'] = D, ['9'] = D,
+    ['a'] = H, ['b'] = H | C_UNIT, ['c'] = H, ['d'] = H, ['e'] = H, ['f'] = H,
+    ['A'] = H, ['B'] = H | C_UNIT, ['C'] = H, ['D'] = H, ['E'] = H, ['F'] = H,
+    ['+'] = C_SIGN, ['-'] = C_SIGN,
+    ['.'] = C_DOT, [','] = C_DOT,
+    [':'] = C_COLON,
+    ['T'] = C_DATE | C_UNIT, ['Z'] = C_DATE, ['/'] = C_DATE,
+    ['k'] = C_UNIT, ['K'] = C_UNIT, ['M'] = C_UNIT, ['G'] = C_UNIT,
+    ['P'] = C_UNIT, ['i'] = C_UNIT, ['%'] = C_UNIT, ['s'] = C_UNIT,
+    ['x'] = C_HEXP, ['X'] = C_HEXP,
+};
+#undef D
+#undef H
+
+static _Atomic int g_enabled = NORMALIZE_OUTPUT;
+static _Atomic unsigned long g_counts[TOKCLASS_COUNT];
+
+/* =========================
+* Public API
+* ========================= */
+
+int normalize_token_class(const char *tok, size_t len) {
+    if (!tok || len == 0) return 0;
+    const unsigned char *p = (const unsigned char *)tok;
+
+    /* paths: decided by the prefix alone */
+    if (p[0] == '/' || ((p[0] == '.' || p[0] == '~') && len > 1 && p[1] == '/')) {
+        return len > 1 ? TOKCLASS_PATH : 0;
+    }
+
+    /* one pass: union of byte classes, a few counts, and where the numeric
+     * body ends (a trailing run of unit bytes is allowed on numbers) */
+    unsigned seen = 0;
+    size_t digits = 0, colons = 0, dashes = 0, slashes = 0, body_end = 0;
+    for (size_t i = 0; i < len; ++i) {
+        unsigned c = cc[p[i]];
+        if (!c) return 0;
+        seen |= c;
+        if (c & C_DIGIT) { digits++; body_end = i + 1; }
+        else if (c & C_COLON) colons++;
+        else if (p[i] == '-') dashes++;
+        else if (p[i] == '/') slashes++;
+    }
+    if (digits == 0) return 0;
+
+    /* 0x-prefixed or long mixed hex runs (addresses, hashes, ids) */
+    if (seen & C_HEXP) {
+        if (len <= 2 || p[0] != '0' || !(cc[p[1]] & C_HEXP)) return 0;
+        for (size_t i = 2; i < len; ++i) if (!(cc[p[i]] & (C_DIGIT | C_HEXA))) return 0;
+        return TOKCLASS_HEX;
+    }
+    if ((seen & ~(unsigned)(C_DIGIT | C_HEXA | C_UNIT)) == 0 && (seen & C_HEXA)
+        && len >= NORMALIZE_HEX_MIN) {
+        for (size_t i = 0; i < len; ++i) if (!(cc[p[i]] & (C_DIGIT | C_HEXA))) return 0;
+        return TOKCLASS_HEX;
+    }
+
+    /* times and dates: digits with ':' or at least two '-' or '/' separators */
+    if ((seen & ~(unsigned)(C_DIGIT | C_SIGN | C_DOT | C_COLON | C_DATE | C_UNIT)) == 0
+        && (colons >= 1 || dashes >= 2 || slashes >= 2) && digits >= 2) {
+        return TOKCLASS_TIME;
+    }
+
+    /* numbers: [sign] digits with . or , separators, then optional units */
+    size_t i = (cc[p[0]] & C_SIGN) ? 1 : 0;
+    if (i >= len || !(cc[p[i]] & C_DIGIT)) return 0;
+    for (; i < body_end; ++i) if (!(cc[p[i]] & (C_DIGIT | C_DOT))) return 0;
+    for (; i < len; ++i) if (!(cc[p[i]] & C_UNIT)) return 0;
+    return len - body_end <= 3 ? TOKCLASS_NUM : 0;
+}
+
+void set_output_normalization(int on) {
+    atomic_store_explicit(&g_enabled, on ? 1 : 0, memory_order_relaxed);
+}
+
+int output_normalization_enabled(void) {
+    return atomic_load_explicit(&g_enabled, memory_order_relaxed);
+}
+
+void normalize_note(int cls) {
+    int k = TOKCLASS_NUM - cls;
+    if (k < 0 || k >= TOKCLASS_COUNT) return;
+    atomic_fetch_add_explicit(&g_counts[k], 1, memory_order_relaxed);
+}
+
+void normalize_counts(unsigned long out[TOKCLASS_COUNT]) {
+    for (int k = 0; k < TOKCLASS_COUNT; ++k) {
+        out[k] = atomic_load_explicit(&g_counts[k], memory_order_relaxed);
+    }
+}
+
+const char *tokclass_name(int cls) {
+    switch (cls) {
+        case TOKCLASS_NUM:  return "num";
+        case TOKCLASS_HEX:  return "hex";
+        case TOKCLASS_PATH: return "path";
+        case TOKCLASS_TIME: return "time";
+        default:            return "?";
+    }
+}
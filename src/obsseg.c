@@ -0,0 +1,251 @@
+// src/obsseg.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "config.h"
+#include "learning.h"
+#include "obsseg.h"
+
+#define OBSSEG_MAGIC   "AMOSEG\0"
+#define OBSSEG_VERSION 1u
+
+typedef struct {
+    char         magic[8];
+    unsigned int version;
+    unsigned int nrows, nints, ntokens;
+} SegHeader;   /* 24 bytes: sig[] right after it stays 8-byte aligned */
+
+static _Atomic unsigned long g_checked;
+static _Atomic unsigned long g_skipped;
+static _Atomic unsigned long g_filtered;
+static _Atomic unsigned long g_scored;
+
+/* =========================
+* Internal helpers
+* ========================= */
+
+static int sig_bit(int t) {
+    return (int)(((unsigned)t * 0x9e3779b1u) >> 26);   /* top 6 bits: 0..63 */
+}
+
+static int cmp_int(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+static int has_token(const ObsSegment *s, int t) {
+    size_t lo = 0, hi = s->ntokens;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (s->tokens[mid] < t) lo = mid + 1; else hi = mid;
+    }
+    return lo < s->ntokens && s->tokens[lo] == t;
+}
+
+static size_t segment_bytes(size_t nrows, size_t nints, size_t ntokens) {
+    return sizeof(SegHeader) + nrows * sizeof(unsigned long long)
+         + (nrows + 1) * sizeof(unsigned int) + (ntokens + nints) * sizeof(int);
+}
+
+/* =========================
+* Public API
+* ========================= */
+
+unsigned long long obsseg_signature(const int *row, int max_len) {
+    unsigned long long sig = 0;
+    for (int i = 0; row && i < max_len && row[i] != IDX_TERMINATOR; ++i) sig |= 1ULL << sig_bit(row[i]);
+    return sig;
+}
+
+int obsseg_path(char *buf, size_t n, const char *dir, unsigned int seq) {
+    int len = snprintf(buf, n, "%s/seg-%06u.bin", dir, seq);
+    return (len < 0 || (size_t)len >= n) ? -1 : 0;
+}
+
+int obsseg_write(const char *dir, unsigned int seq, int *const *rows, size_t nrows) {
+    if (!dir || !rows || nrows == 0) return -1;
+    char path[PATH_MAX], tmp[PATH_MAX + 8];
+    if (obsseg_path(path, sizeof(path), dir, seq) != 0) return -1;
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    size_t nints = 0, nprefix = 0;
+    for (size_t r = 0; r < nrows; ++r) {
+        size_t n = 0;
+        while (rows[r][n] != IDX_TERMINATOR) n++;
+        nints += n + 1;
+        nprefix += n < OBS_COMPARE_MAX ? n : OBS_COMPARE_MAX;
+    }
+    if (nints > 0xffffffffu) return -1;
+
+    unsigned long long *sig = (unsigned long long *)malloc(nrows * sizeof(*sig));
+    unsigned int *off = (unsigned int *)malloc((nrows + 1) * sizeof(*off));
+    int *toks = (int *)malloc((nprefix ? nprefix : 1) * sizeof(*toks));
+    int rc = -1;
+    FILE *fp = NULL;
+    if (!sig || !off || !toks) goto out;
+
+    size_t at = 0, ntok = 0;
+    for (size_t r = 0; r < nrows; ++r) {
+        sig[r] = obsseg_signature(rows[r], OBS_COMPARE_MAX);
+        off[r] = (unsigned int)at;
+        size_t n = 0;
+        while (rows[r][n] != IDX_TERMINATOR) {
+            if (n < OBS_COMPARE_MAX) toks[ntok++] = rows[r][n];
+            n++;
+        }
+        at += n + 1;
+    }
+    off[nrows] = (unsigned int)at;
+    qsort(toks, ntok, sizeof(*toks), cmp_int);
+    size_t nuniq = 0;
+    for (size_t i = 0; i < ntok; ++i) if (nuniq == 0 || toks[nuniq - 1] != toks[i]) toks[nuniq++] = toks[i];
+
+    SegHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, OBSSEG_MAGIC, sizeof(h.magic));
+    h.version = OBSSEG_VERSION;
+    h.nrows = (unsigned int)nrows;
+    h.nints = (unsigned int)nints;
+    h.ntokens = (unsigned int)nuniq;
+
+    fp = fopen(tmp, "wb");
+    if (!fp) goto out;
+    int ok = fwrite(&h, sizeof(h), 1, fp) == 1 &&
+             fwrite(sig, sizeof(*sig), nrows, fp) == nrows &&
+             fwrite(off, sizeof(*off), nrows + 1, fp) == nrows + 1 &&
+             (nuniq == 0 || fwrite(toks, sizeof(*toks), nuniq, fp) == nuniq);
+    for (size_t r = 0; ok && r < nrows; ++r) {
+        size_t n = off[r + 1] - off[r];
+        ok = fwrite(rows[r], sizeof(int), n, fp) == n;
+    }
+    if (fclose(fp) != 0) ok = 0;
+    fp = NULL;
+    if (ok && rename(tmp, path) == 0) rc = 0;
+    else (void)remove(tmp);
+
+out:
+    if (fp) fclose(fp);
+    free(sig);
+    free(off);
+    free(toks);
+    return rc;
+}
+
+int obsseg_open(ObsSegment *s, const char *dir, unsigned int seq) {
+    if (!s || !dir) return -1;
+    memset(s, 0, sizeof(*s));
+    char path[PATH_MAX];
+    if (obsseg_path(path, sizeof(path), dir, seq) != 0) return -1;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(SegHeader)) {
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+
+    const SegHeader *h = (const SegHeader *)map;
+    size_t len = (size_t)st.st_size;
+    const unsigned char *p = (const unsigned char *)map + sizeof(*h);
+    s->map = map;
+    s->map_len = len;
+    if (memcmp(h->magic, OBSSEG_MAGIC, sizeof(h->magic)) != 0 || h->version != OBSSEG_VERSION ||
+        h->nrows == 0 || segment_bytes(h->nrows, h->nints, h->ntokens) != len) {
+        obsseg_close(s);
+        return -1;
+    }
+    s->seq = seq;
+    s->nrows = h->nrows;
+    s->nints = h->nints;
+    s->ntokens = h->ntokens;
+    s->sig = (const unsigned long long *)p;
+    s->row_off = (const unsigned int *)(p + s->nrows * sizeof(*s->sig));
+    s->tokens = (const int *)(s->row_off + s->nrows + 1);
+    s->data = s->tokens + s->ntokens;
+
+    /* offsets must rise and every line must end in its own slot, so a
+     * scan of a corrupt file cannot run on into the next line or past data[] */
+    int ok = s->row_off[0] == 0 && s->row_off[s->nrows] == s->nints;
+    for (size_t r = 0; ok && r < s->nrows; ++r) {
+        ok = s->row_off[r] < s->row_off[r + 1] && s->data[s->row_off[r + 1] - 1] == IDX_TERMINATOR;
+    }
+    if (!ok) {
+        obsseg_close(s);
+        return -1;
+    }
+    return 0;
+}
+
+void obsseg_close(ObsSegment *s) {
+    if (!s) return;
+    if (s->map) munmap(s->map, s->map_len);
+    memset(s, 0, sizeof(*s));
+}
+
+void obsseg_probe_init(ObsProbe *p, const int *line, int n, float threshold_percent) {
+    memset(p, 0, sizeof(*p));
+    if (n > OBS_COMPARE_MAX) n = OBS_COMPARE_MAX;
+    p->line = line;
+    p->n = n;
+    for (int i = 0; i < n && line[i] != IDX_TERMINATOR; ++i) {
+        int d = 0;
+        while (d < p->ndistinct && p->tok[d] != line[i]) d++;
+        if (d == p->ndistinct) p->tok[p->ndistinct++] = line[i];
+        p->mult[d]++;
+        int b = sig_bit(line[i]);
+        p->mask |= 1ULL << b;
+        p->weight[b]++;
+    }
+    /* score <= 100 * matches / n; the slack absorbs float rounding */
+    double need = ((double)threshold_percent - 0.01) * (double)n / 100.0;
+    p->need = need > 0.0 ? (int)(need + 0.999999) : 0;
+}
+
+int obsseg_redundant(const ObsSegment *s, const ObsProbe *p, float threshold_percent,
+                     size_t *best_row, float *best_score) {
+    if (!s || !p || p->n <= 0 || !best_score) return 0;
+    atomic_fetch_add_explicit(&g_checked, 1, memory_order_relaxed);
+
+    int bound = 0;
+    for (int d = 0; d < p->ndistinct; ++d) if (has_token(s, p->tok[d])) bound += p->mult[d];
+    if (bound < p->need) {
+        atomic_fetch_add_explicit(&g_skipped, 1, memory_order_relaxed);
+        return 0;
+    }
+
+    unsigned long filtered = 0, scored = 0;
+    int hit = 0;
+    for (size_t r = 0; r < s->nrows; ++r) {
+        unsigned long long m = s->sig[r] & p->mask;
+        int matches = 0;
+        while (m) { matches += p->weight[__builtin_ctzll(m)]; m &= m - 1; }
+        if (matches < p->need) { filtered++; continue; }
+        scored++;
+        float sc = line_similarity_proximity(p->line, p->n, s->data + s->row_off[r], p->n);
+        if (sc > *best_score) {
+            *best_score = sc;
+            if (best_row) *best_row = r;
+        }
+        if (*best_score >= threshold_percent) { hit = 1; break; }
+    }
+    atomic_fetch_add_explicit(&g_filtered, filtered, memory_order_relaxed);
+    atomic_fetch_add_explicit(&g_scored, scored, memory_order_relaxed);
+    return hit;
+}
+
+void obsseg_counts(unsigned long *checked, unsigned long *skipped,
+                   unsigned long *filtered, unsigned long *scored) {
+    if (checked)  *checked  = atomic_load_explicit(&g_checked, memory_order_relaxed);
+    if (skipped)  *skipped  = atomic_load_explicit(&g_skipped, memory_order_relaxed);
+    if (filtered) *filtered = atomic_load_explicit(&g_filtered, memory_order_relaxed);
+    if (scored)   *scored   = atomic_load_explicit(&g_scored, memory_order_relaxed);
+}
@@ -0,0 +1,148 @@
+// src/outclass.c
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "config.h"
+#include "memacct.h"
+#include "outclass.h"
+
+/* =========================
+* Internal helpers
+* ========================= */
+
+typedef struct {
+    size_t n;         /* bytes looked at */
+    size_t invalid;   /* bytes in malformed UTF-8 sequences or stray controls */
+    int    nul;       /* saw a NUL byte */
+    size_t hist[256];
+} SampleStats;
+
+/* Length of the valid UTF-8 sequence at p (1..4), or 0 if malformed. */
+static size_t utf8_seq(const unsigned char *p, size_t avail) {
+    unsigned char c = p[0];
+    size_t need;
+    if (c < 0x80) return 1;
+    else if (c >= 0xC2 && c <= 0xDF) need = 2;
+    else if (c >= 0xE0 && c <= 0xEF) need = 3;
+    else if (c >= 0xF0 && c <= 0xF4) need = 4;
+    else return 0;
+    if (need > avail) return (size_t)-1; /* truncated by the sample edge */
+    for (size_t k = 1; k < need; ++k) if ((p[k] & 0xC0) != 0x80) return 0;
+    return need;
+}
+
+static int is_text_control(unsigned char c) {
+    return c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v' || c == 0x1b; /* ANSI */
+}
+
+static void scan_sample(SampleStats *st, const unsigned char *p, size_t n) {
+    size_t i = 0;
+    while (i < n) {
+        unsigned char c = p[i];
+        st->hist[c]++;
+        if (c == 0) st->nul = 1;
+        if (c < 0x20 && !is_text_control(c)) { st->invalid++; i++; continue; }
+
+        size_t k = utf8_seq(p + i, n - i);
+        if (k == (size_t)-1) break;           /* sequence cut by the sample; ignore */
+        if (k == 0) { st->invalid++; i++; continue; }
+        for (size_t j = 1; j < k; ++j) st->hist[p[i + j]]++;
+        i += k;
+    }
+    st->n += i;
+}
+
+static double sample_entropy(const SampleStats *st) {
+    if (st->n == 0) return 0.0;
+    double h = 0.0, n = (double)st->n;
+    for (int b = 0; b < 256; ++b) {
+        if (!st->hist[b]) continue;
+        double p = (double)st->hist[b] / n;
+        h -= p * log2(p);
+    }
+    return h;
+}
+
+static size_t round_up_pow2(size_t x) {
+    size_t p = 1; while (p < x) p <<= 1; return p;
+}
+
+/* =========================
+* Public API
+* ========================= */
+
+OutputClass classify_output(const char *buf, size_t len) {
+    if (!buf || len == 0) return OUTPUT_TEXT;
+
+    SampleStats st;
+    memset(&st, 0, sizeof(st));
+    const unsigned char *p = (const unsigned char *)buf;
+    size_t half = OUTCLASS_SAMPLE / 2;
+    if (len <= OUTCLASS_SAMPLE) {
+        scan_sample(&st, p, len);
+    } else {
+        /* head plus middle: headers of binary formats are often ASCII */
+        scan_sample(&st, p, half);
+        scan_sample(&st, p + len / 2, half);
+    }
+
+    if (st.nul) return OUTPUT_BINARY;
+    if (st.n && (double)st.invalid / (double)st.n > OUTCLASS_MAX_INVALID) return OUTPUT_BINARY;
+    if (st.n >= OUTCLASS_MIN_ENTROPY_BYTES && sample_entropy(&st) > OUTCLASS_MAX_ENTROPY) return OUTPUT_BINARY;
+    return OUTPUT_TEXT;
+}
+
+unsigned long blob_hash(const char *buf, size_t len) {
+    /* 8 bytes per step, multiply-xorshift mixing */
+    unsigned long h = 0x9e3779b97f4a7c15UL ^ (unsigned long)len;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        unsigned long w;
+        memcpy(&w, buf + i, 8);
+        h ^= w;
+        h *= 0xff51afd7ed558ccdUL;
+        h ^= h >> 32;
+    }
+    for (; i < len; ++i) { h ^= (unsigned char)buf[i]; h *= 0x100000001b3UL; }
+    h ^= h >> 29; h *= 0xc4ceb9fe1a85ec53UL; h ^= h >> 32;
+    return h ? h : 1;
+}
+
+int blobset_init(BlobSet *s, size_t capacity_hint) {
+    if (!s) return -1;
+    size_t cap = round_up_pow2(capacity_hint ? capacity_hint : OUTCLASS_SEEN_CAPACITY);
+    s->slots = (_Atomic unsigned long *)calloc(cap, sizeof(*s->slots));
+    if (!s->slots) { s->capacity = 0; atomic_init(&s->used, 0); return -1; }
+    s->capacity = cap;
+    atomic_init(&s->used, 0);
+    memacct_add(MEM_TABLES, (long)(cap * sizeof(*s->slots)));
+    return 0;
+}
+
+void blobset_free(BlobSet *s) {
+    if (!s) return;
+    memacct_add(MEM_TABLES, -(long)(s->capacity * sizeof(*s->slots)));
+    free((void *)s->slots);
+    s->slots = NULL;
+    s->capacity = 0;
+}
+
+int blobset_insert(BlobSet *s, unsigned long hash) {
+    if (!s || !s->slots || hash == 0) return 0;
+    size_t mask = s->capacity - 1;
+    size_t idx = (size_t)hash & mask;
+    for (size_t probe = 0; probe < s->capacity; ++probe, idx = (idx + 1) & mask) {
+        unsigned long k = atomic_load_explicit(&s->slots[idx], memory_order_acquire);
+        if (k == hash) return 0;
+        if (k != 0) continue;
+        if ((atomic_load(&s->used) + 1) * 4 > s->capacity * 3) return 0;
+        unsigned long expected = 0;
+        if (atomic_compare_exchange_strong(&s->slots[idx], &expected, hash)) {
+            atomic_fetch_add(&s->used, 1);
+            return 1;
+        }
+        if (expected == hash) return 0;
+    }
+    return 0;
+}
@@ -0,0 +1,161 @@
+// src/pathcache.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/stat.h>
+
+#include "config.h"
+#include "pathcache.h"
+
+/* Marker stored in paths[] for tokens known not to resolve. */
+static char NOT_FOUND[] = "";
+
+/* =========================
+* Internal helpers
+* ========================= */
+
+static double now_monotonic_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int is_exec_file(const char *p) {
+    struct stat st;
+    return stat(p, &st) == 0 && S_ISREG(st.st_mode) && access(p, X_OK) == 0;
+}
+
+static void snapshot_mtimes(PathCache *pc, struct timespec *out) {
+    for (int d = 0; d < pc->ndirs; ++d) {
+        struct stat st;
+        if (stat(pc->dirs[d], &st) == 0) out[d] = st.st_mtim;
+        else { out[d].tv_sec = 0; out[d].tv_nsec = 0; }
+    }
+}
+
+static void drop_entries(PathCache *pc) {
+    for (size_t i = 0; i < pc->cap; ++i) {
+        if (pc->paths[i] && pc->paths[i] != NOT_FOUND) free(pc->paths[i]);
+        pc->paths[i] = NULL;
+    }
+}
+
+/* Drop everything if a PATH directory changed since the last snapshot.
+* Caller holds pc->mutex. */
+static void maybe_invalidate(PathCache *pc) {
+    double now = now_monotonic_s();
+    if ((now - pc->last_check) * 1000.0 < PATHCACHE_RECHECK_MS) return;
+    pc->last_check = now;
+
+    struct timespec cur[PATHCACHE_MAX_DIRS];
+    snapshot_mtimes(pc, cur);
+    for (int d = 0; d < pc->ndirs; ++d) {
+        if (cur[d].tv_sec != pc->dir_mtime[d].tv_sec || cur[d].tv_nsec != pc->dir_mtime[d].tv_nsec) {
+            memcpy(pc->dir_mtime, cur, sizeof(cur[0]) * (size_t)pc->ndirs);
+            drop_entries(pc);
+            pc->invalidations++;
+            return;
+        }
+    }
+}
+
+static int ensure_cap(PathCache *pc, size_t need) {
+    if (need <= pc->cap) return 0;
+    size_t ncap = pc->cap ? pc->cap : 256;
+    while (ncap < need) ncap *= 2;
+    char **grown = (char **)realloc(pc->paths, ncap * sizeof(*grown));
+    if (!grown) return -1;
+    memset(grown + pc->cap, 0, (ncap - pc->cap) * sizeof(*grown));
+    pc->paths = grown;
+    pc->cap = ncap;
+    return 0;
+}
+
+/* =========================
+* Public API
+* ========================= */
+
+int path_lookup(char *const *dirs, int ndirs, const char *name, char *out, size_t outsz) {
+    if (!name || !*name) return 0;
+    if (strchr(name, '/')) {
+        if (!is_exec_file(name)) return 0;
+        if (out && outsz) snprintf(out, outsz, "%s", name);
+        return 1;
+    }
+    char full[PATH_MAX];
+    for (int d = 0; d < ndirs; ++d) {
+        snprintf(full, sizeof(full), "%s/%s", dirs[d], name);
+        if (is_exec_file(full)) {
+            if (out && outsz) snprintf(out, outsz, "%s", full);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int pathcache_init(PathCache *pc, const char *path_env) {
+    if (!pc) return -1;
+    memset(pc, 0, sizeof(*pc));
+    const char *envp = path_env ? path_env : getenv("PATH");
+    if (!envp || !*envp) envp = "/usr/local/sbin:/usr/local/bin:/usr/sbin:/usr/bin:/sbin:/bin";
+    pc->pathbuf = strdup(envp);
+    if (!pc->pathbuf) return -1;
+
+    char *saveptr = NULL;
+    for (char *d = strtok_r(pc->pathbuf, ":", &saveptr); d && pc->ndirs < PATHCACHE_MAX_DIRS;
+         d = strtok_r(NULL, ":", &saveptr)) {
+        pc->dirs[pc->ndirs++] = d;
+    }
+    snapshot_mtimes(pc, pc->dir_mtime);
+    pc->last_check = now_monotonic_s();
+    pthread_mutex_init(&pc->mutex, NULL);
+    return 0;
+}
+
+void pathcache_free(PathCache *pc) {
+    if (!pc) return;
+    if (pc->paths) {
+        drop_entries(pc);
+        free(pc->paths);
+    }
+    free(pc->pathbuf);
+    pc->paths = NULL;
+    pc->pathbuf = NULL;
+    pc->cap = 0;
+    pc->ndirs = 0;
+    pthread_mutex_destroy(&pc->mutex);
+}
+
+int pathcache_resolve(PathCache *pc, int id, const char *name, char *out, size_t outsz) {
+    if (!pc || id < 0 || !name) return 0;
+
+    pthread_mutex_lock(&pc->mutex);
+    maybe_invalidate(pc);
+    if (ensure_cap(pc, (size_t)id + 1) != 0) {
+        pthread_mutex_unlock(&pc->mutex);
+        return path_lookup(pc->dirs, pc->ndirs, name, out, outsz);
+    }
+
+    char *p = pc->paths[id];
+    if (p) {
+        pc->hits++;
+    } else {
+        /* resolve under the lock; misses are rare once the cache is warm */
+        char full[PATH_MAX];
+        pc->misses++;
+        if (path_lookup(pc->dirs, pc->ndirs, name, full, sizeof(full))) {
+            p = strdup(full);
+            pc->paths[id] = p;
+        } else {
+            p = NOT_FOUND;
+            pc->paths[id] = p;
+        }
+    }
+
+    int found = (p && p != NOT_FOUND);
+    if (found && out && outsz) snprintf(out, outsz, "%s", p);
+    pthread_mutex_unlock(&pc->mutex);
+    return found;
+}
@@ -0,0 +1,183 @@
+// src/prof.c
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "config.h"
+#include "prof.h"
+
+static _Atomic int                g_enabled;
+static _Atomic int                g_avail;     /* PROF_* bits opened by any thread */
+static _Atomic int                g_errno;     /* first open failure, for the report */
+static _Atomic unsigned long      g_calls[PROF_STAGES];
+static _Atomic unsigned long long g_ns[PROF_STAGES];
+static _Atomic unsigned long long g_tot[PROF_STAGES][PROF_COUNTERS];
+static _Atomic unsigned long      g_scaled;    /* intervals the group was multiplexed in */
+
+/* Per-thread counter group: state 0 = not tried, 1 = open, -1 = unavailable. */
+typedef struct {
+    int state;
+    int leader;                   /* group leader fd */
+    int fd[PROF_COUNTERS];        /* -1 = not opened */
+    int slot[PROF_COUNTERS];      /* position in the group read, -1 = absent */
+    int nopen;
+} ProfThread;
+
+static _Thread_local ProfThread t_prof;
+
+/* =========================
+* Internal helpers
+* ========================= */
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int open_counter(unsigned long long config, int group_fd) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = group_fd < 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+static void thread_open(ProfThread *pt) {
+    static const unsigned long long config[PROF_COUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+    };
+    pt->leader = -1;
+    pt->nopen = 0;
+    for (int c = 0; c < PROF_COUNTERS; ++c) {
+        pt->fd[c] = open_counter(config[c], pt->leader);
+        pt->slot[c] = -1;
+        if (pt->fd[c] < 0) {
+            int expected = 0;
+            atomic_compare_exchange_strong(&g_errno, &expected, errno ? errno : EINVAL);
+            continue;
+        }
+        if (pt->leader < 0) pt->leader = pt->fd[c];
+        pt->slot[c] = pt->nopen++;
+        atomic_fetch_or_explicit(&g_avail, 1 << c, memory_order_relaxed);
+    }
+    if (pt->leader < 0) { pt->state = -1; return; }
+    ioctl(pt->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(pt->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    pt->state = 1;
+}
+
+/* Current counter values (0 for absent counters) and the group's enabled
+* and running times; running < enabled means the kernel multiplexed it. */
+static void thread_read(ProfThread *pt, ProfMark *m) {
+    memset(m->v, 0, sizeof(m->v));
+    m->enabled = m->running = 0;
+    if (pt->state != 1) return;
+    unsigned long long buf[3 + PROF_COUNTERS];   /* nr, enabled, running, values */
+    ssize_t n = read(pt->leader, buf, sizeof(buf));
+    if (n < (ssize_t)(3 * sizeof(buf[0]))) return;
+    m->enabled = buf[1];
+    m->running = buf[2];
+    for (int c = 0; c < PROF_COUNTERS; ++c) {
+        if (pt->slot[c] >= 0 && (unsigned long long)pt->slot[c] < buf[0]) m->v[c] = buf[3 + pt->slot[c]];
+    }
+}
+
+/* =========================
+* Public API
+* ========================= */
+
+void prof_enable(int on) {
+    atomic_store_explicit(&g_enabled, on ? 1 : 0, memory_order_relaxed);
+}
+
+int prof_enabled(void) {
+    return atomic_load_explicit(&g_enabled, memory_order_relaxed);
+}
+
+void prof_begin(ProfMark *m) {
+    m->on = prof_enabled();
+    if (!m->on) return;
+    if (t_prof.state == 0) thread_open(&t_prof);
+    thread_read(&t_prof, m);
+    m->t = now_s();
+}
+
+void prof_end(ProfStage stage, const ProfMark *m) {
+    if (!m->on || stage < 0 || stage >= PROF_STAGES) return;
+    double t = now_s();
+    ProfMark e;
+    thread_read(&t_prof, &e);
+    atomic_fetch_add_explicit(&g_calls[stage], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&g_ns[stage], (unsigned long long)((t - m->t) * 1e9), memory_order_relaxed);
+
+    /* While multiplexed the group only counted for `running` of the
+     * `enabled` time; extrapolate the deltas like perf stat does. */
+    double scale = 1.0;
+    unsigned long long de = e.enabled - m->enabled, dr = e.running - m->running;
+    if (e.enabled >= m->enabled && e.running >= m->running && dr < de) {
+        scale = dr > 0 ? (double)de / (double)dr : 0.0;
+        atomic_fetch_add_explicit(&g_scaled, 1, memory_order_relaxed);
+    }
+    for (int c = 0; c < PROF_COUNTERS; ++c) {
+        if (e.v[c] < m->v[c]) continue;
+        unsigned long long d = (unsigned long long)((double)(e.v[c] - m->v[c]) * scale + 0.5);
+        atomic_fetch_add_explicit(&g_tot[stage][c], d, memory_order_relaxed);
+    }
+}
+
+void prof_thread_exit(void) {
+    if (t_prof.state == 1) {
+        for (int c = 0; c < PROF_COUNTERS; ++c) if (t_prof.fd[c] >= 0) close(t_prof.fd[c]);
+    }
+    t_prof.state = 0;
+}
+
+void prof_report(FILE *fp) {
+    static const char *const names[PROF_STAGES] = {
+        "construct", "tokenize", "redundancy", "assoc", "persist",
+    };
+    if (!fp || !prof_enabled()) return;
+    int avail = atomic_load(&g_avail);
+    if (avail == 0) {
+        int e = atomic_load(&g_errno);
+        fprintf(fp, "[profile] hardware counters unavailable (%s); wall time only\n",
+                e ? strerror(e) : "not opened");
+    } else if (avail != (1 << PROF_COUNTERS) - 1) {
+        fprintf(fp, "[profile] some hardware counters unavailable; missing columns show n/a\n");
+    }
+    unsigned long scaled = atomic_load(&g_scaled);
+    if (scaled > 0) {
+        fprintf(fp, "[profile] counters were multiplexed in %lu interval(s); those counts are scaled estimates\n",
+                scaled);
+    }
+    fprintf(fp, "[profile] %-11s %9s %10s %9s %12s %6s %11s %11s\n",
+            "stage", "calls", "total ms", "us/call", "cycles/call", "IPC", "LLC miss/c", "br miss/c");
+    for (int s = 0; s < PROF_STAGES; ++s) {
+        unsigned long n = atomic_load(&g_calls[s]);
+        if (n == 0) continue;
+        double ns = (double)atomic_load(&g_ns[s]);
+        double tot[PROF_COUNTERS];
+        for (int c = 0; c < PROF_COUNTERS; ++c) tot[c] = (double)atomic_load(&g_tot[s][c]);
+        char cyc[16] = "n/a", ipc[16] = "n/a", llc[16] = "n/a", br[16] = "n/a";
+        if (avail & (1 << PROF_CYCLES)) snprintf(cyc, sizeof(cyc), "%.0f", tot[PROF_CYCLES] / (double)n);
+        if ((avail & (1 << PROF_CYCLES)) && (avail & (1 << PROF_INSTRUCTIONS)) && tot[PROF_CYCLES] > 0.0)
+            snprintf(ipc, sizeof(ipc), "%.2f", tot[PROF_INSTRUCTIONS] / tot[PROF_CYCLES]);
+        if (avail & (1 << PROF_LLC_MISSES)) snprintf(llc, sizeof(llc), "%.1f", tot[PROF_LLC_MISSES] / (double)n);
+        if (avail & (1 << PROF_BRANCH_MISSES)) snprintf(br, sizeof(br), "%.1f", tot[PROF_BRANCH_MISSES] / (double)n);
+        fprintf(fp, "[profile] %-11s %9lu %10.1f %9.2f %12s %6s %11s %11s\n",
+                names[s], n, ns / 1e6, ns / 1e3 / (double)n, cyc, ipc, llc, br);
+    }
+}
@@ -0,0 +1,269 @@
+// src/soak.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <limits.h>
+#include <dirent.h>
+
+#include "config.h"
+#include "model.h"
+#include "database.h"
+#include "command.h"
+#include "trend.h"
+#include "bufpool.h"
+#include "exec.h"     // termination_requested
+#include "memacct.h"
+#include "soak.h"
+
+/* Filler the tokenizer does not know, as real output is mostly made of. */
+static const char *const k_filler[] = {
+    "error", "usage", "file", "not", "found", "option", "invalid", "the",
+    "for", "to", "is", "directory", "permission", "denied", "missing", "operand",
+};
+#define NFILLER ((int)(sizeof(k_filler) / sizeof(k_filler[0])))
+
+/* One report row's accumulators (stage times in seconds). */
+typedef struct {
+    unsigned long cmds, novel;
+    double        construct_s, learn_s;
+    double        construct_max, learn_max;
+} SoakInterval;
+
+/* =========================
+* Internal helpers
+* ========================= */
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 33; x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33; x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static size_t rss_bytes(void) {
+    FILE *fp = fopen("/proc/self/statm", "r");
+    if (!fp) return 0;
+    unsigned long size = 0, resident = 0;
+    int n = fscanf(fp, "%lu %lu", &size, &resident);
+    fclose(fp);
+    return n == 2 ? (size_t)resident * (size_t)sysconf(_SC_PAGESIZE) : 0;
+}
+
+static int append(ByteBuf *out, const char *s, size_t n) {
+    if (bytebuf_reserve(out, out->len + n + 1) != 0) return -1;
+    memcpy(out->data + out->len, s, n);
+    out->len += n;
+    out->data[out->len] = '\0';
+    return 0;
+}
+
+/* The fake executor: output, exit code and cost are functions of the
+ * command alone, so re-running a command teaches nothing new. Known
+ * tokens are drawn with a skew toward low ids (the product of two
+ * uniforms) and mixed with filler and numbers (normalized to classes). */
+static char *fake_exec(const Words *w, const int *cmd, ByteBuf *out, ExecStats *xs) {
+    uint64_t h = 0x9e3779b97f4a7c15ULL;
+    for (int i = 0; cmd[i] != IDX_TERMINATOR && i < CMDMAX; ++i) h = mix64(h ^ (uint64_t)(unsigned)cmd[i]);
+
+    out->len = 0;
+    if (bytebuf_reserve(out, 1) != 0) return NULL;
+    out->data[0] = '\0';
+    int lines = 1 + (int)(h % SOAK_FAKE_LINES);
+    char word[32];
+    for (int l = 0; l < lines; ++l) {
+        int words = 3 + (int)((h >> 8) % 6);
+        for (int k = 0; k < words; ++k) {
+            h = mix64(h + 0x632be59bd9b4e019ULL);
+            const char *s = word;
+            if ((h & 7) == 0) {
+                s = k_filler[(h >> 3) % NFILLER];
+            } else if ((h & 7) == 1) {
+                snprintf(word, sizeof(word), "%lu", (unsigned long)((h >> 8) % 100000));
+            } else {
+                double u = (double)((h >> 11) & 0xfffff) / 1048576.0;
+                double v = (double)((h >> 31) & 0xfffff) / 1048576.0;
+                s = w->token[(size_t)(u * v * (double)w->numWords)];
+            }
+            if (append(out, s, strlen(s)) != 0 || append(out, k + 1 < words ? " " : "\n", 1) != 0) return NULL;
+        }
+    }
+
+    memset(xs, 0, sizeof(*xs));
+    xs->wall_s = 0.001 * exp2((double)((h >> 40) % 6));   /* 1..32 ms */
+    xs->cpu_s = xs->wall_s / 4.0;
+    xs->out_bytes = out->len;
+    xs->exit_code = (h >> 48) % 5 == 0 ? 1 : 0;
+    return out->data;
+}
+
+/* Remove the soak's segment directory and the files in it. */
+static void remove_segment_dir(const char *dir) {
+    DIR *dh = opendir(dir);
+    struct dirent *ent;
+    char path[PATH_MAX];
+    while (dh && (ent = readdir(dh)) != NULL) {
+        if (ent->d_name[0] == '.') continue;
+        if (snprintf(path, sizeof(path), "%s/%s", dir, ent->d_name) < (int)sizeof(path)) (void)unlink(path);
+    }
+    if (dh) closedir(dh);
+    (void)rmdir(dir);
+}
+
+/* Least-squares slope of y on x. */
+static double slope(const double *x, const double *y, int n) {
+    if (n < 2) return 0.0;
+    double mx = 0.0, my = 0.0;
+    for (int i = 0; i < n; ++i) { mx += x[i]; my += y[i]; }
+    mx /= n; my /= n;
+    double sxy = 0.0, sxx = 0.0;
+    for (int i = 0; i < n; ++i) { sxy += (x[i] - mx) * (y[i] - my); sxx += (x[i] - mx) * (x[i] - mx); }
+    return sxx > 0.0 ? sxy / sxx : 0.0;
+}
+
+/* =========================
+* Public API
+* ========================= */
+
+int run_soak(FILE *fp, double sim_seconds, const CommandSettings *settings) {
+    if (!fp || !settings || !(sim_seconds > 0.0)) return 1;
+
+    Words w;
+    Observations o;
+    init_words(&w);
+    init_observations(&o);
+    char segdir[] = "/tmp/amoeba-soak-XXXXXX";
+    int tiered = OBS_HOT_ROWS > 0 && mkdtemp(segdir) != NULL;
+    if (tiered && attach_observation_segments(&o, segdir) != 0) {
+        remove_segment_dir(segdir);
+        tiered = 0;
+    }
+    char name[32];
+    for (int i = 0; i < SOAK_VOCAB; ++i) {
+        snprintf(name, sizeof(name), "t%d", i);
+        (void)add_word(&w, name);
+    }
+    LearningTrendTracker tracker;
+    init_trend_tracker(&tracker);
+    WorkerBuffers bufs;
+    worker_buffers_init(&bufs);
+
+    CommandSettings cs;
+    cs.length    = settings->length;
+    cs.scope     = settings->scope;
+    cs.budget_us = settings->budget_us;
+    cs.explore   = settings->explore;
+    pthread_mutex_init(&cs.mutex, NULL);
+
+    double row_every = sim_seconds / SOAK_SAMPLES;
+    fprintf(fp, "[soak] %.0f simulated second(s), %zu synthetic token(s), length=%d, scope=%d%%, "
+            "budget=%dus, explore=%.1f; a row every %.1f simulated s\n",
+            sim_seconds, w.numWords, cs.length, cs.scope, cs.budget_us, cs.explore, row_every);
+    if (tiered) {
+        fprintf(fp, "[soak] observations beyond %d hot line(s) sealed into %s\n", OBS_HOT_ROWS, segdir);
+    }
+    fprintf(fp, "[soak] %8s %8s %8s %9s %9s %9s %8s %8s %8s %8s %8s %8s\n",
+            "sim s", "cmds", "words", "obs", "assoc", "cmd/s", "gen us", "gen max", "lrn us", "lrn max",
+            "RSS MB", "acct MB");
+
+    double lx[SOAK_SAMPLES], ly[SOAK_SAMPLES], ox[SOAK_SAMPLES], ry[SOAK_SAMPLES];
+    int nrows = 0, nfit = 0;
+    double sim = 0.0, next_row = row_every;
+    unsigned long total_cmds = 0;
+    SoakInterval iv;
+    memset(&iv, 0, sizeof(iv));
+    double iv_start = now_s();
+    size_t rss0 = rss_bytes();
+
+    while (sim < sim_seconds && !termination_requested) {
+        int cmd[CMDMAX + 1];
+        double t0 = now_s();
+        int argc = construct_command(&w, &cs, cmd, &bufs.cands);
+        double t1 = now_s();
+        if (argc <= 0) break;
+        ExecStats xs;
+        char *output = fake_exec(&w, cmd, &bufs.out, &xs);
+        if (!output) break;
+        double t2 = now_s();
+        int novel = 0;
+        int lrnval = update_database(&w, &o, output, cmd, &xs, &novel, &bufs);
+        update_trend_tracker(&tracker, lrnval);
+        double t3 = now_s();
+
+        iv.cmds++;
+        iv.novel += (unsigned long)novel;
+        iv.construct_s += t1 - t0;
+        iv.learn_s     += t3 - t2;
+        if (t1 - t0 > iv.construct_max) iv.construct_max = t1 - t0;
+        if (t3 - t2 > iv.learn_max) iv.learn_max = t3 - t2;
+        sim += xs.wall_s;
+        total_cmds++;
+
+        if (sim >= next_row || sim >= sim_seconds) {
+            size_t nobs = o.numObservations + o.numSealing + o.numCold;
+            double real = now_s() - iv_start;
+            double rate = real > 0.0 ? (double)iv.cmds / real : 0.0;
+            size_t rss = rss_bytes(), acct;
+            memacct_total(&acct, NULL);
+            double n = (double)iv.cmds;
+            fprintf(fp, "[soak] %8.0f %8lu %8zu %9zu %9zu %9.0f %8.1f %8.0f %8.1f %8.0f %8.1f %8.1f\n",
+                    sim, total_cmds, w.numWords, nobs, w.assoc.nentries, rate,
+                    iv.construct_s / n * 1e6, iv.construct_max * 1e6,
+                    iv.learn_s / n * 1e6, iv.learn_max * 1e6, (double)rss / 1048576.0,
+                    (double)acct / 1048576.0);
+            fflush(fp);
+            if (nrows < SOAK_SAMPLES && nobs > 0 && rate > 0.0) {
+                lx[nfit] = log((double)nobs);
+                ly[nfit] = log(rate);
+                ox[nfit] = (double)nobs;
+                ry[nfit] = (double)rss;
+                nfit++;
+            }
+            nrows++;
+            next_row += row_every;
+            memset(&iv, 0, sizeof(iv));
+            iv_start = now_s();
+        }
+    }
+
+    /* Skip the first row in the fit: it mostly measures warm-up. */
+    int skip = nfit > 3 ? 1 : 0;
+    double k = slope(lx + skip, ly + skip, nfit - skip);
+    double per_obs = slope(ox + skip, ry + skip, nfit - skip);
+    int rc = 0;
+    if (nfit - skip >= 2) {
+        fprintf(fp, "[soak] throughput ~ observations^%.2f; RSS %+.0f bytes per observation "
+                "(%.1f MB -> %.1f MB over %zu observation(s))\n",
+                k, per_obs, (double)rss0 / 1048576.0, (double)rss_bytes() / 1048576.0,
+                o.numObservations + o.numSealing + o.numCold);
+        if (k < SOAK_MIN_EXPONENT) {
+            fprintf(fp, "[soak] %s: throughput falls faster than observations^%.2f%s\n",
+                    SOAK_GATE ? "FAIL" : "note", (double)SOAK_MIN_EXPONENT,
+                    SOAK_GATE ? "" : " (gate off, see SOAK_GATE)");
+            if (SOAK_GATE) rc = 1;
+        }
+    } else {
+        fprintf(fp, "[soak] too few samples to fit scaling (%d row(s)); run longer\n", nfit);
+    }
+
+    memacct_report(fp);
+    pthread_mutex_destroy(&cs.mutex);
+    worker_buffers_free(&bufs);
+    destroy_trend_tracker(&tracker);
+    cleanup_database(&w, &o);
+    if (tiered) remove_segment_dir(segdir);
+    if (memacct_check_released(fp) != 0) {
+        fprintf(fp, "[soak] FAIL: model memory not released at teardown\n");
+        rc = 1;
+    }
+    return rc;
+}
@@ -0,0 +1,179 @@
+// src/split.c
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "config.h"
+#include "split.h"
+
+#if SPLIT_SIMD && (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SPLIT_HAVE_X86 1
+#include <immintrin.h>
+#else
+#define SPLIT_HAVE_X86 0
+#endif
+
+/* =========================
+* Internal helpers
+* ========================= */
+
+typedef struct {
+    const char *base;
+    SplitFn     fn;
+    void       *ctx;
+    size_t      start;    /* offset of the token being scanned */
+    size_t      count;
+    int         in_tok;
+    int         stop;
+} SplitState;
+
+static inline int is_ws(unsigned char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static inline void emit(SplitState *st, size_t end) {
+    st->count++;
+    if (st->fn && st->fn(st->base + st->start, end - st->start, st->ctx)) st->stop = 1;
+}
+
+/* Consume one block of `width` bytes at offset `off` given its whitespace
+* bitmask (bit i set = byte off+i is a delimiter). Alternates between
+* looking for the next token start and the next token end, so the cost is
+* one ctz per boundary rather than one branch per byte. */
+static inline void walk_mask(SplitState *st, uint64_t ws, size_t off, int width) {
+    uint64_t full  = width == 64 ? ~0ULL : ((1ULL << width) - 1);
+    uint64_t nonws = ~ws & full;
+    int pos = 0;
+    while (pos < width && !st->stop) {
+        uint64_t live = full & (~0ULL << pos);
+        uint64_t m = (st->in_tok ? ws : nonws) & live;
+        if (!m) return;
+        int b = __builtin_ctzll(m);
+        if (st->in_tok) {
+            emit(st, off + (size_t)b);
+            st->in_tok = 0;
+        } else {
+            st->start = off + (size_t)b;
+            st->in_tok = 1;
+        }
+        pos = b;
+    }
+}
+
+/* Mask for a short tail block, built byte by byte. */
+static inline uint64_t tail_mask(const char *p, size_t n) {
+    uint64_t m = 0;
+    for (size_t i = 0; i < n; ++i) if (is_ws((unsigned char)p[i])) m |= 1ULL << i;
+    return m;
+}
+
+static size_t finish(SplitState *st, size_t len) {
+    if (st->in_tok && !st->stop) emit(st, len);
+    return st->count;
+}
+
+static size_t split_scalar(const char *buf, size_t len, SplitFn fn, void *ctx) {
+    SplitState st = { buf, fn, ctx, 0, 0, 0, 0 };
+    for (size_t i = 0; i < len && !st.stop; ++i) {
+        int ws = is_ws((unsigned char)buf[i]);
+        if (st.in_tok && ws) { emit(&st, i); st.in_tok = 0; }
+        else if (!st.in_tok && !ws) { st.start = i; st.in_tok = 1; }
+    }
+    return finish(&st, len);
+}
+
+#if SPLIT_HAVE_X86
+
+__attribute__((target("sse2")))
+static size_t split_sse2(const char *buf, size_t len, SplitFn fn, void *ctx) {
+    SplitState st = { buf, fn, ctx, 0, 0, 0, 0 };
+    const __m128i sp = _mm_set1_epi8(' '),  tb = _mm_set1_epi8('\t');
+    const __m128i cr = _mm_set1_epi8('\r'), lf = _mm_set1_epi8('\n');
+    size_t i = 0;
+    for (; i + 16 <= len && !st.stop; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(const void *)(buf + i));
+        __m128i w = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, sp), _mm_cmpeq_epi8(v, tb)),
+                                 _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf)));
+        walk_mask(&st, (uint64_t)(unsigned)_mm_movemask_epi8(w), i, 16);
+    }
+    if (i < len && !st.stop) walk_mask(&st, tail_mask(buf + i, len - i), i, (int)(len - i));
+    return finish(&st, len);
+}
+
+__attribute__((target("avx2")))
+static size_t split_avx2(const char *buf, size_t len, SplitFn fn, void *ctx) {
+    SplitState st = { buf, fn, ctx, 0, 0, 0, 0 };
+    const __m256i sp = _mm256_set1_epi8(' '),  tb = _mm256_set1_epi8('\t');
+    const __m256i cr = _mm256_set1_epi8('\r'), lf = _mm256_set1_epi8('\n');
+    size_t i = 0;
+    for (; i + 32 <= len && !st.stop; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(const void *)(buf + i));
+        __m256i w = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, sp), _mm256_cmpeq_epi8(v, tb)),
+                                    _mm256_or_si256(_mm256_cmpeq_epi8(v, cr), _mm256_cmpeq_epi8(v, lf)));
+        walk_mask(&st, (uint64_t)(uint32_t)_mm256_movemask_epi8(w), i, 32);
+    }
+    if (i < len && !st.stop) walk_mask(&st, tail_mask(buf + i, len - i), i, (int)(len - i));
+    return finish(&st, len);
+}
+
+#endif /* SPLIT_HAVE_X86 */
+
+typedef size_t (*SplitImplFn)(const char *, size_t, SplitFn, void *);
+
+static SplitImplFn impl_fn(SplitImpl impl) {
+    switch (impl) {
+        #if SPLIT_HAVE_X86
+        case SPLIT_SSE2: return split_sse2;
+        case SPLIT_AVX2: return split_avx2;
+        #endif
+        default:         return split_scalar;
+    }
+}
+
+/* =========================
+* Public API
+* ========================= */
+
+int split_impl_available(SplitImpl impl) {
+    switch (impl) {
+        case SPLIT_SCALAR: return 1;
+        #if SPLIT_HAVE_X86
+        case SPLIT_SSE2:   return __builtin_cpu_supports("sse2") != 0;
+        case SPLIT_AVX2:   return __builtin_cpu_supports("avx2") != 0;
+        #endif
+        default:           return 0;
+    }
+}
+
+const char *split_impl_name(SplitImpl impl) {
+    switch (impl) {
+        case SPLIT_SCALAR: return "scalar";
+        case SPLIT_SSE2:   return "sse2";
+        case SPLIT_AVX2:   return "avx2";
+        default:           return "?";
+    }
+}
+
+SplitImpl split_active_impl(void) {
+    static _Atomic int chosen = -1;
+    int c = atomic_load_explicit(&chosen, memory_order_relaxed);
+    if (c < 0) {
+        c = SPLIT_SCALAR;
+        for (int k = SPLIT_IMPLS - 1; k > SPLIT_SCALAR; --k) {
+            if (split_impl_available((SplitImpl)k)) { c = k; break; }
+        }
+        atomic_store_explicit(&chosen, c, memory_order_relaxed);
+    }
+    return (SplitImpl)c;
+}
+
+size_t split_whitespace_with(SplitImpl impl, const char *buf, size_t len,
+                             SplitFn fn, void *ctx) {
+    if (!buf || len == 0) return 0;
+    if (!split_impl_available(impl)) impl = SPLIT_SCALAR;
+    return impl_fn(impl)(buf, len, fn, ctx);
+}
+
+size_t split_whitespace(const char *buf, size_t len, SplitFn fn, void *ctx) {
+    if (!buf || len == 0) return 0;
+    return impl_fn(split_active_impl())(buf, len, fn, ctx);
+}
@@ -0,0 +1,219 @@
+// src/state.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "config.h"
+#include "model.h"
+#include "trend.h"
+#include "exestats.h"
+#include "state.h"
+
+#define STATE_MAGIC   "amoeba-state"
+#define STATE_VERSION 1
+
+/* Longest record: exe <id> + 6 counters + the wall-time histogram. */
+#define STATE_MAX_FIELDS (8 + EXESTATS_HIST_BUCKETS + CMDMAX + TREND_WINDOW_SIZE)
+
+/* =========================
+* Internal helpers
+* ========================= */
+
+/* Up to `max` integers from `s`; returns how many were read. */
+static int parse_longs(const char *s, long *out, int max) {
+    int n = 0;
+    while (n < max) {
+        char *end;
+        long v = strtol(s, &end, 10);
+        if (end == s) break;
+        out[n++] = v;
+        s = end;
+    }
+    return n;
+}
+
+/* Record keyword at the start of `line`: returns the rest, or NULL. */
+static const char *record(const char *line, const char *kw) {
+    size_t n = strlen(kw);
+    if (strncmp(line, kw, n) != 0 || (line[n] != ' ' && line[n] != '\n' && line[n] != '\0')) return NULL;
+    return line + n;
+}
+
+static unsigned short sat_u16(long v) {
+    return v <= 0 ? 0 : v >= USHRT_MAX ? USHRT_MAX : (unsigned short)v;
+}
+
+/* =========================
+* Public API
+* ========================= */
+
+int load_state(Words *w, CommandSettings *settings, LearningTrendTracker *tracker, const char *path) {
+    if (!w) return -1;
+    if (!path) path = STATE_FILE;
+    FILE *fp = fopen(path, "r");
+    if (!fp) return 0;   /* first run, or the state was removed: start cold */
+
+    char *line = NULL;
+    size_t cap = 0;
+    long f[STATE_MAX_FIELDS];
+    int version = -1;
+    if (getline(&line, &cap, fp) > 0) {
+        const char *rest = record(line, STATE_MAGIC);
+        if (rest && parse_longs(rest, f, 1) == 1) version = (int)f[0];
+    }
+    if (version != STATE_VERSION) {
+        fprintf(stderr, "[warn] %s: not a version %d state file; ignoring it\n", path, STATE_VERSION);
+        free(line);
+        fclose(fp);
+        return -1;
+    }
+
+    TrendState ts;
+    memset(&ts, 0, sizeof(ts));
+    int length = 0, tokens_ok = 0, pairs_ok = 0;
+    size_t nexe = 0, npairs = 0;
+    const char *rest;
+    while (getline(&line, &cap, fp) > 0) {
+        int n;
+        if ((rest = record(line, "vocab"))) {
+            n = parse_longs(rest, f, 1);
+            tokens_ok = (n == 1 && f[0] == (long)w->numWords);
+            if (!tokens_ok) {
+                fprintf(stderr, "[warn] %s: vocabulary changed (%ld saved, %zu loaded); "
+                        "restoring tuner and trend only\n", path, n == 1 ? f[0] : -1L, w->numWords);
+            }
+        } else if ((rest = record(line, "length"))) {
+            if (parse_longs(rest, f, 1) == 1) length = (int)f[0];
+        } else if ((rest = record(line, "trend"))) {
+            /* trend <samples> <ewma...> */
+            char *end;
+            ts.samples = strtol(rest, &end, 10);
+            for (int e = 0; e < TREND_EWMA_COUNT; ++e) ts.ewma[e] = strtod(end, &end);
+        } else if ((rest = record(line, "window"))) {
+            n = parse_longs(rest, f, TREND_WINDOW_SIZE);
+            for (int i = 0; i < n; ++i) ts.window[i] = (int)f[i];
+            ts.nwindow = n;
+        } else if (!tokens_ok) {
+            continue;
+        } else if ((rest = record(line, "pos_tries"))) {
+            n = parse_longs(rest, f, CMDMAX);
+            for (int p = 0; p < n; ++p) w->pos_tries[p] = f[p] > 0 ? (unsigned long)f[p] : 0;
+        } else if ((rest = record(line, "tries"))) {
+            /* tries <id> <uses> <per-position tries...> */
+            n = parse_longs(rest, f, 2 + CMDMAX);
+            if (n < 2 || f[0] < 0 || (size_t)f[0] >= w->numWords) continue;
+            size_t id = (size_t)f[0];
+            w->meta.uses[id] = f[1] > 0 && f[1] <= (long)UINT_MAX ? (unsigned int)f[1] : 0;
+            for (int p = 0; p + 2 < n; ++p) w->meta.tries[id * CMDMAX + (size_t)p] = sat_u16(f[2 + p]);
+        } else if ((rest = record(line, "pairs"))) {
+            /* pair slots are hash positions: only valid for the same table size */
+            pairs_ok = parse_longs(rest, f, 1) == 1 && w->pair_tries.slot &&
+                       f[0] == (long)(w->pair_tries.mask + 1);
+        } else if ((rest = record(line, "pair"))) {
+            if (!pairs_ok || parse_longs(rest, f, 2) != 2) continue;
+            if (f[0] < 0 || (size_t)f[0] > w->pair_tries.mask) continue;
+            w->pair_tries.slot[f[0]] = sat_u16(f[1]);
+            npairs++;
+        } else if ((rest = record(line, "exe"))) {
+            /* exe <id> <runs> <novel> <failures> <reward_sum> <wall_us> <out_bytes> <hist...> */
+            n = parse_longs(rest, f, 7 + EXESTATS_HIST_BUCKETS);
+            if (n < 7 || f[0] < 0 || (size_t)f[0] >= w->numWords) continue;
+            ExeStatsCounts c;
+            memset(&c, 0, sizeof(c));
+            c.runs          = f[1] > 0 ? (unsigned long)f[1] : 0;
+            c.novel         = f[2] > 0 ? (unsigned long)f[2] : 0;
+            c.failures      = f[3] > 0 ? (unsigned long)f[3] : 0;
+            c.reward_sum    = f[4];
+            c.wall_us_sum   = f[5] > 0 ? (unsigned long)f[5] : 0;
+            c.out_bytes_sum = f[6] > 0 ? (unsigned long)f[6] : 0;
+            for (int b = 0; b + 7 < n; ++b) c.wall_hist[b] = f[7 + b] > 0 ? (unsigned int)f[7 + b] : 0;
+            if (exestats_add_counts(&w->exestats, (int)f[0], &c) == 0) nexe++;
+        }
+    }
+    free(line);
+    fclose(fp);
+
+    if (settings && length > 0) {
+        settings->length = CLAMP(length, CMDMIN, CMDMAX);
+    }
+    if (tracker) restore_trend_state(tracker, &ts);
+
+#if LOG_ACTIONS
+    fprintf(stdout, "[state] restored length %d, trend over %ld sample(s), %zu executable(s), "
+            "%zu pair counter(s) from %s\n",
+            length, ts.samples, nexe, npairs, path);
+#endif
+    return 0;
+}
+
+int write_state(const Words *w, const CommandSettings *settings, const LearningTrendTracker *tracker, const char *path) {
+    if (!w) return -1;
+    if (!path) path = STATE_FILE;
+    char tmp[PATH_MAX];
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp)) return -1;
+    FILE *fp = fopen(tmp, "w");
+    if (!fp) { perror("fopen state"); return -1; }
+
+    fprintf(fp, "%s %d\n", STATE_MAGIC, STATE_VERSION);
+    fprintf(fp, "vocab %zu\n", w->numWords);
+    if (settings) {
+        fprintf(fp, "length %d\n", settings->length);
+    }
+    if (tracker) {
+        TrendState ts;
+        get_trend_state(tracker, &ts);
+        fprintf(fp, "trend %ld", ts.samples);
+        for (int e = 0; e < TREND_EWMA_COUNT; ++e) fprintf(fp, " %.17g", ts.ewma[e]);
+        fprintf(fp, "\nwindow");
+        for (int i = 0; i < ts.nwindow; ++i) fprintf(fp, " %d", ts.window[i]);
+        fputc('\n', fp);
+    }
+
+    fprintf(fp, "pos_tries");
+    for (int p = 0; p < CMDMAX; ++p) fprintf(fp, " %lu", w->pos_tries[p]);
+    fputc('\n', fp);
+    for (size_t i = 0; i < w->numWords; ++i) {
+        const unsigned short *t = &w->meta.tries[i * CMDMAX];
+        int any = w->meta.uses[i] != 0;
+        for (int p = 0; p < CMDMAX && !any; ++p) any = t[p] != 0;
+        if (!any) continue;
+        fprintf(fp, "tries %zu %u", i, w->meta.uses[i]);
+        for (int p = 0; p < CMDMAX; ++p) fprintf(fp, " %u", t[p]);
+        fputc('\n', fp);
+    }
+
+    size_t npairs = 0, nexe = 0;
+    if (w->pair_tries.slot) {
+        fprintf(fp, "pairs %zu\n", w->pair_tries.mask + 1);
+        for (size_t s = 0; s <= w->pair_tries.mask; ++s) {
+            if (!w->pair_tries.slot[s]) continue;
+            fprintf(fp, "pair %zu %u\n", s, w->pair_tries.slot[s]);
+            npairs++;
+        }
+    }
+
+    size_t cursor = 0;
+    int token;
+    ExeStatsCounts c;
+    while (exestats_next_counts(&w->exestats, &cursor, &token, &c)) {
+        fprintf(fp, "exe %d %lu %lu %lu %ld %lu %lu", token, c.runs, c.novel, c.failures,
+                c.reward_sum, c.wall_us_sum, c.out_bytes_sum);
+        for (int b = 0; b < EXESTATS_HIST_BUCKETS; ++b) fprintf(fp, " %u", c.wall_hist[b]);
+        fputc('\n', fp);
+        nexe++;
+    }
+
+    int rc = ferror(fp) ? -1 : 0;
+    if (fclose(fp) != 0) rc = -1;
+    if (rc == 0 && rename(tmp, path) != 0) rc = -1;
+    if (rc != 0) {
+        fprintf(stderr, "[persist] failed writing %s\n", path);
+        (void)remove(tmp);
+        return -1;
+    }
+#if LOG_ACTIONS
+    fprintf(stdout, "[persist] wrote state (%zu executable(s), %zu pair counter(s)) -> %s\n", nexe, npairs, path);
+#endif
+    return 0;
+}
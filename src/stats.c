@@ -0,0 +1,219 @@
+// src/stats.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "config.h"
+#include "model.h"
+#include "exestats.h"
+#include "normalize.h"
+#include "bufpool.h"
+#include "command.h"
+#include "inflight.h"
+#include "prof.h"
+#include "memacct.h"
+#include "obsseg.h"
+#include "stats.h"
+
+/* =========================
+* Global counters
+* ========================= */
+
+static _Atomic unsigned long g_spawns;
+static _Atomic unsigned long g_exit127;
+static _Atomic unsigned long g_launch[STATS_LAUNCH_KINDS];
+static _Atomic unsigned long g_outputs[OUTPUT_BINARY + 1];
+static _Atomic unsigned long g_output_bytes[OUTPUT_BINARY + 1];
+
+/* =========================
+* Internal helpers
+* ========================= */
+
+typedef struct {
+    int          token;
+    ExeStatsView v;
+} ExeRow;
+
+static int cmp_runs_desc(const void *a, const void *b) {
+    const ExeRow *x = (const ExeRow *)a, *y = (const ExeRow *)b;
+    return (x->v.runs < y->v.runs) - (x->v.runs > y->v.runs);
+}
+
+static int cmp_yield_desc(const void *a, const void *b) {
+    const ExeRow *x = (const ExeRow *)a, *y = (const ExeRow *)b;
+    return (x->v.mean_reward < y->v.mean_reward) - (x->v.mean_reward > y->v.mean_reward);
+}
+
+static int cmp_p90_desc(const void *a, const void *b) {
+    const ExeRow *x = (const ExeRow *)a, *y = (const ExeRow *)b;
+    return (x->v.p90_wall_ms < y->v.p90_wall_ms) - (x->v.p90_wall_ms > y->v.p90_wall_ms);
+}
+
+/* Token text for reports; copies under words->mutex since token[] may move. */
+static void token_name(const Words *w, int idx, char *out, size_t outsz) {
+    pthread_mutex_lock((pthread_mutex_t *)&w->mutex);
+    const char *t = (idx >= 0 && (size_t)idx < w->numWords) ? w->token[idx] : NULL;
+    snprintf(out, outsz, "%s", t ? t : "?");
+    pthread_mutex_unlock((pthread_mutex_t *)&w->mutex);
+}
+
+static void print_exe_table(FILE *fp, const Words *w, const char *title,
+                            const ExeRow *rows, size_t n) {
+    fprintf(fp, "  %s\n", title);
+    fprintf(fp, "    %-20s %8s %7s %6s %8s %8s %8s %8s %10s\n",
+            "leader", "runs", "novel", "fail%", "avg lrn", "p50 ms", "p90 ms", "p99 ms", "avg out B");
+    for (size_t i = 0; i < n && i < STATS_TOP_N; ++i) {
+        char name[32];
+        token_name(w, rows[i].token, name, sizeof(name));
+        const ExeStatsView *v = &rows[i].v;
+        fprintf(fp, "    %-20s %8lu %7lu %5.1f%% %8.2f %8.0f %8.0f %8.0f %10.0f\n",
+                name, v->runs, v->novel,
+                v->runs ? 100.0 * (double)v->failures / (double)v->runs : 0.0,
+                v->mean_reward, v->p50_wall_ms, v->p90_wall_ms, v->p99_wall_ms,
+                v->mean_out_bytes);
+    }
+}
+
+static void report_exestats(FILE *fp, const Words *w) {
+    const ExeStats *es = &w->exestats;
+    size_t cap = atomic_load(&((ExeStats *)es)->used);
+    fprintf(fp, "[stats] executables: %zu leader(s) tracked, %lu record(s) dropped\n",
+            cap, atomic_load(&((ExeStats *)es)->dropped));
+    if (cap == 0) return;
+
+    ExeRow *rows = (ExeRow *)malloc(cap * sizeof(*rows));
+    if (!rows) return;
+    size_t n = 0, cursor = 0, dead = 0;
+    while (n < cap && exestats_next(es, &cursor, &rows[n].token, &rows[n].v)) {
+        if (rows[n].v.runs == 0) continue;
+        int is_dead = 0;
+        (void)exestats_first_score(es, rows[n].token, &is_dead);
+        dead += (size_t)is_dead;
+        n++;
+    }
+
+    qsort(rows, n, sizeof(*rows), cmp_runs_desc);
+    print_exe_table(fp, w, "most run:", rows, n);
+    qsort(rows, n, sizeof(*rows), cmp_yield_desc);
+    print_exe_table(fp, w, "most productive (avg lrnval):", rows, n);
+    qsort(rows, n, sizeof(*rows), cmp_p90_desc);
+    print_exe_table(fp, w, "slowest (p90 wall):", rows, n);
+    fprintf(fp, "  %zu leader(s) skipped as dead (>= %d runs, all failed, nothing new)\n",
+            dead, EXESTATS_DEAD_RUNS);
+    free(rows);
+}
+
+/* Vocabulary summary from the token metadata arrays, plus the most used tokens. */
+static void report_tokens(FILE *fp, const Words *w) {
+    pthread_mutex_lock((pthread_mutex_t *)&w->mutex);
+    size_t n = w->numWords, nexec = 0, nmeta = 0, untried = 0;
+    int top[STATS_TOP_N];
+    int ntop = 0;
+    for (size_t i = 0; i < n; ++i) {
+        unsigned char f = w->meta.flags[i];
+        nexec += (f & TOK_EXEC) != 0;
+        nmeta += (f & TOK_META) != 0;
+        unsigned int u = w->meta.uses[i];
+        untried += u == 0;
+        if (u == 0) continue;
+        /* insertion into a small descending top-N list */
+        int at = ntop < STATS_TOP_N ? ntop++ : STATS_TOP_N;
+        while (at > 0 && w->meta.uses[top[at - 1]] < u) {
+            if (at < STATS_TOP_N) top[at] = top[at - 1];
+            at--;
+        }
+        if (at < STATS_TOP_N) top[at] = (int)i;
+    }
+    fprintf(fp, "[stats] tokens: %zu (%zu executable, %zu with shell metachars, %zu never tried), lookup table %.1f KiB; most used:",
+            n, nexec, nmeta, untried, (double)toktab_bytes(&w->lookup) / 1024.0);
+    for (int i = 0; i < ntop; ++i) {
+        const char *t = w->token[top[i]];
+        const TokEntry *e = t ? toktab_lookup(&w->lookup, t, w->meta.len[top[i]]) : NULL;
+        fprintf(fp, " %s(%u/%lu)", t ? t : "?", w->meta.uses[top[i]],
+                e ? atomic_load_explicit(&((TokEntry *)e)->hits, memory_order_relaxed) : 0UL);
+    }
+    fprintf(fp, "%s\n", ntop ? "  [uses/seen in output]" : " none");
+    pthread_mutex_unlock((pthread_mutex_t *)&w->mutex);
+}
+
+static void report_spawns(FILE *fp, const Words *w) {
+    unsigned long n = atomic_load(&g_spawns), nf = atomic_load(&g_exit127);
+    fprintf(fp, "[stats] spawns: %lu, exit 127 (not found): %lu (%.1f%%); "
+                "leaders from exec index: %s (%zu executable token(s))\n",
+            n, nf, n ? 100.0 * (double)nf / (double)n : 0.0,
+            EXEC_ONLY_LEADERS ? "on" : "off", w->numExec);
+    fprintf(fp, "[stats] launches: %lu via shell, %lu direct exec, %lu skipped (leader not on PATH)\n",
+            atomic_load(&g_launch[STATS_LAUNCH_SHELL]),
+            atomic_load(&g_launch[STATS_LAUNCH_DIRECT]),
+            atomic_load(&g_launch[STATS_LAUNCH_SKIPPED]));
+    fprintf(fp, "[stats] outputs: %lu text, %lu binary (%.1f MiB hashed, not tokenized)\n",
+            atomic_load(&g_outputs[OUTPUT_TEXT]), atomic_load(&g_outputs[OUTPUT_BINARY]),
+            (double)atomic_load(&g_output_bytes[OUTPUT_BINARY]) / (1024.0 * 1024.0));
+
+    double p50, p99;
+    unsigned long nbuilt;
+    construct_latency(&p50, &p99, &nbuilt);
+    fprintf(fp, "[stats] construct_command: %lu call(s), p50 %.1f us, p99 %.1f us\n", nbuilt, p50, p99);
+    fprintf(fp, "[stats] worker buffers: %lu growth(s) in total\n", bufpool_grows());
+
+    unsigned long avoided, gave_up;
+    inflight_counts(&avoided, &gave_up);
+    fprintf(fp, "[stats] in-flight dedup (%s): %lu duplicate execution(s) avoided, %lu turn(s) skipped\n",
+            INFLIGHT_DEDUP ? "on" : "off", avoided, gave_up);
+
+    unsigned long nc[TOKCLASS_COUNT];
+    normalize_counts(nc);
+    fprintf(fp, "[stats] normalized tokens (%s):", output_normalization_enabled() ? "on" : "off");
+    for (int k = 0; k < TOKCLASS_COUNT; ++k) fprintf(fp, " %s %lu", tokclass_name(TOKCLASS_NUM - k), nc[k]);
+    fprintf(fp, "\n");
+}
+
+/* Hot/cold split of the observation lines and how selective cold checks were. */
+static void report_observations(FILE *fp, const Observations *o) {
+    if (!o) return;
+    pthread_mutex_lock((pthread_mutex_t *)&o->mutex);
+    size_t hot = o->numObservations + o->numSealing, cold = o->numCold, nseg = o->numSegments, mapped = 0;
+    for (size_t i = 0; i < nseg; ++i) mapped += o->segs[i].map_len;
+    int tiered = o->segdir != NULL;
+    pthread_mutex_unlock((pthread_mutex_t *)&o->mutex);
+
+    unsigned long checked, skipped, filtered, scored;
+    obsseg_counts(&checked, &skipped, &filtered, &scored);
+    fprintf(fp, "[stats] observations: %zu hot, %zu cold in %zu segment(s) (%.1f MiB mapped, sealing %s); "
+                "cold checks: %lu segment(s) consulted, %lu skipped by token index, "
+                "%lu line(s) skipped by signature, %lu scored\n",
+            hot, cold, nseg, (double)mapped / (1024.0 * 1024.0), tiered ? "on" : "off",
+            checked, skipped, filtered, scored);
+}
+
+/* =========================
+* Public API
+* ========================= */
+
+void stats_note_launch(StatsLaunch kind) {
+    if (kind < 0 || kind >= STATS_LAUNCH_KINDS) return;
+    atomic_fetch_add_explicit(&g_launch[kind], 1, memory_order_relaxed);
+}
+
+void stats_note_spawn(int exit_code) {
+    atomic_fetch_add_explicit(&g_spawns, 1, memory_order_relaxed);
+    if (exit_code == 127) atomic_fetch_add_explicit(&g_exit127, 1, memory_order_relaxed);
+}
+
+void stats_note_output(OutputClass cls, size_t bytes) {
+    if (cls < OUTPUT_TEXT || cls > OUTPUT_BINARY) return;
+    atomic_fetch_add_explicit(&g_outputs[cls], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&g_output_bytes[cls], (unsigned long)bytes, memory_order_relaxed);
+}
+
+void print_stats_report(FILE *fp, const Words *words, const Observations *observations) {
+    if (!fp || !words) return;
+    report_spawns(fp, words);
+    report_tokens(fp, words);
+    report_observations(fp, observations);
+    report_exestats(fp, words);
+    memacct_report(fp);
+    prof_report(fp);
+    fflush(fp);
+}
@@ -9,6 +9,7 @@
 #include <time.h>      // nanosleep, clock_gettime
 #include <stdarg.h>    // va_list
 #include <ctype.h>     // isprint
+#include <limits.h>    // PATH_MAX
 
 #include "config.h"
 #include "model.h"
@@ -17,6 +18,13 @@
 #include "exec.h"      // termination_requested
 #include "database.h"
 #include "trend.h"
+#include "stats.h"
+#include "pathcache.h"
+#include "bufpool.h"
+#include "inflight.h"
+#include "prof.h"
+#include "trace.h"
+#include "experiment.h"
 
 /* =========================
 * Global semaphore
@@ -74,60 +82,149 @@ static void preview_output(const char *in, size_t n, char *out, size_t outsz) {
 * Internal helpers
 * ========================= */
 
-/* Build a shell command string from token indices.
-* Returns a heap-allocated NUL-terminated string the caller must free().
-* On failure or empty command, returns NULL.
+/* Build a shell command string from token indices into `out` (reused).
+* Lengths come from the token metadata, so the line is sized and filled in
+* one pass each without strlen. *needs_shell is set if any token carries
+* whitespace or shell metacharacters (TOK_META).
+* Returns out->data (NUL-terminated, owned by `out`), or NULL on failure or
+* empty command.
 */
-static char *build_command_line(const Words *words, const int cmd[CMDMAX + 1]) {
-    if (!words || !cmd) return NULL;
+static char *build_command_line(const Words *words, const int cmd[CMDMAX + 1],
+                                ByteBuf *out, int *needs_shell) {
+    if (!words || !cmd || !out) return NULL;
 
     /* first pass: compute needed length */
     size_t total = 0;
-    int argc = 0;
+    int argc = 0, meta = 0;
 
     /* Words is shared; lock for consistent reads. Cast away const only to lock. */
-    pthread_mutex_lock((pthread_mutex_t *)&words->mutex);
+    trace_lock((pthread_mutex_t *)&words->mutex, TRACE_LOCK_WORDS);
     for (int i = 0; i < CMDMAX && cmd[i] != IDX_TERMINATOR; ++i) {
         int idx = cmd[i];
-        if (idx < 0 || (size_t)idx >= words->numWords) continue;
-        const char *w = words->token[idx];
-        if (!w) continue;
-        total += strlen(w);
+        if (idx < 0 || (size_t)idx >= words->numWords || !words->token[idx]) continue;
+        total += words->meta.len[idx] + (argc ? 1 : 0);
+        meta |= words->meta.flags[idx] & TOK_META;
         argc++;
-        if (i) total += 1; /* space */
     }
-    if (argc == 0) {
-        pthread_mutex_unlock((pthread_mutex_t *)&words->mutex);
-        return NULL;
-    }
-
-    char *line = (char *)malloc(total + 1);
-    if (!line) {
+    if (argc == 0 || bytebuf_reserve(out, total + 1) != 0) {
         pthread_mutex_unlock((pthread_mutex_t *)&words->mutex);
         return NULL;
     }
 
     /* second pass: concatenate */
+    char *line = out->data;
     size_t off = 0;
-    int first = 1;
+    int n = 0;
     for (int i = 0; i < CMDMAX && cmd[i] != IDX_TERMINATOR; ++i) {
         int idx = cmd[i];
-        if (idx < 0 || (size_t)idx >= words->numWords) continue;
-        const char *w = words->token[idx];
-        if (!w) continue;
-
-        if (!first) line[off++] = ' ';
-        size_t len = strlen(w);
-        memcpy(line + off, w, len);
-        off += len;
-        first = 0;
+        if (idx < 0 || (size_t)idx >= words->numWords || !words->token[idx]) continue;
+        if (n++) line[off++] = ' ';
+        memcpy(line + off, words->token[idx], words->meta.len[idx]);
+        off += words->meta.len[idx];
     }
     pthread_mutex_unlock((pthread_mutex_t *)&words->mutex);
 
     line[off] = '\0';
+    out->len = off;
+    if (needs_shell) *needs_shell = meta != 0;
     return line;
 }
 
+/* Shell-only builtins: never on PATH, so they must go through /bin/sh. */
+static int is_shell_builtin(const char *name) {
+    static const char *const builtins[] = {
+        ".", ":", "alias", "bg", "cd", "command", "eval", "exec", "exit", "export",
+        "fg", "getopts", "hash", "jobs", "read", "readonly", "return", "set",
+        "shift", "times", "trap", "type", "ulimit", "umask", "unalias", "unset", "wait",
+    };
+    for (size_t i = 0; i < sizeof(builtins) / sizeof(builtins[0]); ++i) {
+        if (strcmp(name, builtins[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+/* Launch a built command line. Plain commands (no shell metacharacters) are
+* exec'd directly by the cached PATH resolution of their leader, or not
+* spawned at all when it doesn't resolve (reported as exit 127 with empty
+* output). Everything else goes through /bin/sh as before.
+* Output is captured into bufs->out; returns bufs->out.data or NULL. */
+static char *launch_command(ThreadData *data, const int cmd[CMDMAX + 1],
+                            char *cmdline, int needs_shell,
+                            WorkerBuffers *bufs, ExecStats *xs) {
+    memset(xs, 0, sizeof(*xs));   /* read by the caller even when this returns NULL */
+    if (!data->pathcache || needs_shell) {
+        stats_note_launch(STATS_LAUNCH_SHELL);
+        return execute_command_into(cmdline, &bufs->out, xs);
+    }
+
+    /* tokens are single-space separated and metachar-free: split a copy */
+    size_t clen = strlen(cmdline);
+    if (bytebuf_reserve(&bufs->args, clen + 1) != 0) return NULL;
+    char *argbuf = bufs->args.data;
+    memcpy(argbuf, cmdline, clen + 1);
+    char *argv[CMDMAX + 1];
+    int argc = 0;
+    char *save = NULL;
+    for (char *t = strtok_r(argbuf, " ", &save); t && argc < CMDMAX; t = strtok_r(NULL, " ", &save)) {
+        argv[argc++] = t;
+    }
+    argv[argc] = NULL;
+
+    char abs[PATH_MAX];
+    if (argc == 0 || is_shell_builtin(argv[0])) {
+        stats_note_launch(STATS_LAUNCH_SHELL);
+        return execute_command_into(cmdline, &bufs->out, xs);
+    }
+    if (pathcache_resolve(data->pathcache, cmd[0], argv[0], abs, sizeof(abs))) {
+        stats_note_launch(STATS_LAUNCH_DIRECT);
+        return execute_argv_into(abs, argv, &bufs->out, xs);
+    }
+
+    stats_note_launch(STATS_LAUNCH_SKIPPED);
+    xs->exit_code = 127;   /* spawned stays 0 */
+    if (bytebuf_reserve(&bufs->out, 1) != 0) return NULL;
+    bufs->out.data[0] = '\0';
+    bufs->out.len = 0;
+    return bufs->out.data;
+}
+
+/* Build a command no other worker is running right now. Each duplicate
+* found in flight is rebuilt, up to INFLIGHT_RETRIES times; on success the
+* command stays claimed until inflight_release. Returns argc, or 0 when
+* nothing could be built (or every attempt was a duplicate). */
+static int construct_unique_command(ThreadData *data, int cmd[CMDMAX + 1], IntBuf *scratch) {
+    for (int attempt = 0; ; ++attempt) {
+        int argc = construct_command(data->words, data->settings, cmd, scratch);
+        if (argc <= 0 || !data->inflight) return argc;
+        if (inflight_claim(data->inflight, data->worker_id, inflight_key(cmd))) return argc;
+        if (attempt >= INFLIGHT_RETRIES) {
+            inflight_note_gave_up();
+            return 0;
+        }
+    }
+}
+
+static double thread_cpu_s(void) {
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return 0.0;
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static double monotonic_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* A/B mode: charge one loop iteration, whatever its outcome, to the
+* worker's arm; `it_wall`/`it_cpu` were taken at the top of the loop. */
+static void charge_arm(const ThreadData *data, ExpBatch *acc, int novel,
+                       double it_wall, double it_cpu, double child_cpu_s) {
+    if (!data->experiment) return;
+    experiment_note(data->experiment, data->arm, acc, novel,
+                    monotonic_s() - it_wall, thread_cpu_s() - it_cpu + child_cpu_s);
+}
+
 /* Interruptible semaphore wait: returns 0 on acquired, -1 on shutdown/error. */
 static int sem_wait_interruptible(sem_t *s) {
     for (;;) {
@@ -185,19 +282,45 @@ void *worker_thread(void *arg) {
 
     logf_safe("[T%lu] worker started\n", (unsigned long)pthread_self());
 
+    /* Reused across iterations; the steady-state loop does not allocate. */
+    WorkerBuffers bufs;
+    worker_buffers_init(&bufs);
+
+    /* Learning efficiency: new observations per second spent executing. */
+    unsigned long novel_total = 0;
+    double exec_s_total = 0.0;
+
+    /* A/B mode: this worker's running batch for its arm */
+    ExpBatch arm_acc = { 0, 0.0, 0.0, 0.0 };
+
+    char tname[32];
+    snprintf(tname, sizeof(tname), "worker %d", data->worker_id);
+    trace_thread_name(tname);
+
     while (!termination_requested) {
+        trace_poll_dump();
+        double it_wall = data->experiment ? monotonic_s() : 0.0;
+        double it_cpu  = data->experiment ? thread_cpu_s() : 0.0;
         int cmd_indices[CMDMAX + 1];
-        int argc = construct_command(data->words, data->settings, cmd_indices);
+        ProfMark pm;
+        prof_begin(&pm);
+        uint64_t tr = trace_begin();
+        int argc = construct_unique_command(data, cmd_indices, &bufs.cands);
+        trace_end(TRACE_GENERATE, tr);
+        prof_end(PROF_CONSTRUCT, &pm);
         if (argc <= 0) {
             /* Nothing to do yet; brief yield so we don't spin hot. */
             struct timespec ts = {0, 50 * 1000 * 1000}; // 50 ms
             nanosleep(&ts, NULL);
+            charge_arm(data, &arm_acc, 0, it_wall, it_cpu, 0.0);
             continue;
         }
 
-        char *cmdline = build_command_line(data->words, cmd_indices);
+        int needs_shell = 0;
+        char *cmdline = build_command_line(data->words, cmd_indices, &bufs.cmd, &needs_shell);
         if (!cmdline || cmdline[0] == '\0') {
-            free(cmdline);
+            inflight_release(data->inflight, data->worker_id);
+            charge_arm(data, &arm_acc, 0, it_wall, it_cpu, 0.0);
             continue;
         }
 
@@ -205,7 +328,9 @@ void *worker_thread(void *arg) {
         logf_safe("[T%lu] $ %s\n", (unsigned long)pthread_self(), cmdline);
 #endif
 
-        char *output = execute_command(cmdline);
+        ExecStats xs;
+        char *output = launch_command(data, cmd_indices, cmdline, needs_shell, &bufs, &xs);
+        inflight_release(data->inflight, data->worker_id);
 
 #if LOG_ACTIONS
         if (!output) {
@@ -214,23 +339,37 @@ void *worker_thread(void *arg) {
 #endif
 
         if (output) {
-            int lrnval = update_database(data->words, data->observations, output, cmd_indices);
+            if (xs.spawned) stats_note_spawn(xs.exit_code);
+            int novel = 0;
+            tr = trace_begin();
+            int lrnval = update_database(data->words, data->observations, output, cmd_indices,
+                                         &xs, &novel, &bufs);
+            trace_end(TRACE_LEARN, tr);
             update_trend_tracker(data->tracker, lrnval);
+            novel_total  += (unsigned long)novel;
+            exec_s_total += xs.wall_s;
+            charge_arm(data, &arm_acc, novel, it_wall, it_cpu, xs.cpu_s);
 
 #if LOG_ACTIONS
             char prev[LOG_OUTPUT_PREVIEW + 8];
             preview_output(output, LOG_OUTPUT_PREVIEW, prev, sizeof prev);
             double ma = get_moving_average(data->tracker);
-            logf_safe("[T%lu] -> lrn=%d, avg=%.2f, out=%zuB: \"%s\"\n",
-                      (unsigned long)pthread_self(), lrnval, ma, strlen(output), prev);
+            logf_safe("[T%lu] -> lrn=%d, avg=%.2f, %.3fs/%.3fs cpu, out=%zuB: \"%s\"\n",
+                      (unsigned long)pthread_self(), lrnval, ma, xs.wall_s, xs.cpu_s,
+                      xs.out_bytes, prev);
 #endif
-            free(output);
+        } else {
+            charge_arm(data, &arm_acc, 0, it_wall, it_cpu, xs.cpu_s);   /* exec failed */
         }
-
-        free(cmdline);
     }
 
-    logf_safe("[T%lu] worker stopping (signal)\n", (unsigned long)pthread_self());
+    logf_safe("[T%lu] worker stopping (signal): %lu new obs in %.1fs exec (%.3f/s), %zu buffer bytes held\n",
+              (unsigned long)pthread_self(), novel_total, exec_s_total,
+              exec_s_total > 0.0 ? (double)novel_total / exec_s_total : 0.0,
+              worker_buffers_bytes(&bufs));
+    experiment_flush(data->experiment, data->arm, &arm_acc);
+    worker_buffers_free(&bufs);
+    prof_thread_exit();
     (void)sem_post(&thread_sem);
     return NULL;
 }
@@ -0,0 +1,147 @@
+// src/toktab.c
+#include <stdlib.h>
+#include <string.h>
+#include <stdalign.h>
+
+#include "config.h"
+#include "memacct.h"
+#include "toktab.h"
+
+struct TokArena {
+    struct TokArena *next;
+    size_t           used, cap;
+    alignas(max_align_t) unsigned char data[];
+};
+
+/* =========================
+* Internal helpers
+* ========================= */
+
+static size_t round_up_pow2(size_t x) {
+    size_t p = 1; while (p < x) p <<= 1; return p;
+}
+
+static TokSlots *slots_new(size_t cap, TokSlots *retired) {
+    TokSlots *s = (TokSlots *)malloc(sizeof(*s) + cap * sizeof(s->slot[0]));
+    if (!s) return NULL;
+    memacct_add(MEM_LOOKUP, (long)(sizeof(*s) + cap * sizeof(s->slot[0])));
+    s->retired = retired;
+    s->mask = cap - 1;
+    for (size_t i = 0; i < cap; ++i) atomic_init(&s->slot[i], NULL);
+    return s;
+}
+
+static size_t slots_bytes(const TokSlots *s) {
+    return sizeof(*s) + (s->mask + 1) * sizeof(s->slot[0]);
+}
+
+/* Writer-side placement into `s` (no duplicate check). */
+static void slots_place(TokSlots *s, TokEntry *e) {
+    size_t i = (size_t)e->hash & s->mask;
+    while (atomic_load_explicit(&s->slot[i], memory_order_relaxed)) i = (i + 1) & s->mask;
+    atomic_store_explicit(&s->slot[i], e, memory_order_release);
+}
+
+static void *arena_alloc(TokenTable *t, size_t n) {
+    n = (n + alignof(TokEntry) - 1) & ~(alignof(TokEntry) - 1);
+    TokArena *a = t->arena;
+    if (!a || a->used + n > a->cap) {
+        size_t cap = n > TOKTAB_ARENA_CHUNK ? n : TOKTAB_ARENA_CHUNK;
+        TokArena *na = (TokArena *)malloc(sizeof(*na) + cap);
+        if (!na) return NULL;
+        na->next = a;
+        na->used = 0;
+        na->cap = cap;
+        t->arena = na;
+        t->arena_bytes += sizeof(*na) + cap;
+        memacct_add(MEM_LOOKUP, (long)(sizeof(*na) + cap));
+        a = na;
+    }
+    void *p = a->data + a->used;
+    a->used += n;
+    return p;
+}
+
+/* Double the slot array and publish it; the old one stays readable. */
+static int grow(TokenTable *t) {
+    TokSlots *old = atomic_load_explicit(&t->slots, memory_order_relaxed);
+    TokSlots *ns = slots_new((old->mask + 1) * 2, old);
+    if (!ns) return -1;
+    for (size_t i = 0; i <= old->mask; ++i) {
+        TokEntry *e = atomic_load_explicit(&old->slot[i], memory_order_relaxed);
+        if (e) slots_place(ns, e);
+    }
+    atomic_store_explicit(&t->slots, ns, memory_order_release);
+    return 0;
+}
+
+/* =========================
+* Public API
+* ========================= */
+
+unsigned long toktab_hash(const char *s, size_t n) {
+    unsigned long h = 1469598103934665603UL; /* FNV-1a 64 */
+    for (size_t i = 0; i < n; ++i) { h ^= (unsigned char)s[i]; h *= 1099511628211UL; }
+    return h;
+}
+
+int toktab_init(TokenTable *t, size_t capacity_hint) {
+    if (!t) return -1;
+    memset(t, 0, sizeof(*t));
+    TokSlots *s = slots_new(round_up_pow2(capacity_hint ? capacity_hint : TOKTAB_INITIAL_SLOTS), NULL);
+    atomic_init(&t->slots, s);
+    return s ? 0 : -1;
+}
+
+void toktab_free(TokenTable *t) {
+    if (!t) return;
+    TokSlots *s = atomic_load(&t->slots);
+    memacct_add(MEM_LOOKUP, -(long)toktab_bytes(t));
+    while (s) { TokSlots *r = s->retired; free(s); s = r; }
+    TokArena *a = t->arena;
+    while (a) { TokArena *n = a->next; free(a); a = n; }
+    atomic_store(&t->slots, NULL);
+    t->arena = NULL;
+    t->arena_bytes = 0;
+    t->count = 0;
+}
+
+int toktab_insert(TokenTable *t, const char *s, size_t n, int id) {
+    if (!t || !s) return -1;
+    TokSlots *cur = atomic_load_explicit(&t->slots, memory_order_relaxed);
+    if (!cur) return -1;
+    /* keep at most half full so misses end quickly */
+    if ((t->count + 1) * 2 > cur->mask + 1 && grow(t) != 0) return -1;
+
+    TokEntry *e = (TokEntry *)arena_alloc(t, sizeof(*e) + n + 1);
+    if (!e) return -1;
+    e->hash = toktab_hash(s, n);
+    e->id = id;
+    e->len = (unsigned int)n;
+    atomic_init(&e->hits, 0);
+    memcpy(e->str, s, n);
+    e->str[n] = '\0';
+
+    slots_place(atomic_load_explicit(&t->slots, memory_order_relaxed), e);
+    t->count++;
+    return 0;
+}
+
+TokEntry *toktab_lookup(const TokenTable *t, const char *s, size_t n) {
+    if (!t || !s) return NULL;
+    TokSlots *cur = atomic_load_explicit(&((TokenTable *)t)->slots, memory_order_acquire);
+    if (!cur) return NULL;
+    unsigned long h = toktab_hash(s, n);
+    for (size_t i = (size_t)h & cur->mask;; i = (i + 1) & cur->mask) {
+        TokEntry *e = atomic_load_explicit(&cur->slot[i], memory_order_acquire);
+        if (!e) return NULL;
+        if (e->hash == h && e->len == n && memcmp(e->str, s, n) == 0) return e;
+    }
+}
+
+size_t toktab_bytes(const TokenTable *t) {
+    if (!t) return 0;
+    size_t b = t->arena_bytes;
+    for (TokSlots *s = atomic_load(&((TokenTable *)t)->slots); s; s = s->retired) b += slots_bytes(s);
+    return b;
+}
@@ -0,0 +1,187 @@
+// src/trace.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "config.h"
+#include "trace.h"
+
+typedef struct {
+    uint64_t start_ns;   /* since g_epoch_ns */
+    uint32_t dur_ns;     /* saturates at ~4.3 s */
+    uint16_t kind;
+    uint16_t pad;
+} TraceEvent;
+
+typedef struct {
+    _Atomic uint64_t head;   /* events ever written; slot = head % TRACE_RING_EVENTS */
+    int              tid;
+    char             name[32];
+    TraceEvent       ev[TRACE_RING_EVENTS];
+} TraceRing;
+
+static char                  *g_path;
+static _Atomic int            g_on;
+static uint64_t               g_epoch_ns;
+static TraceRing *_Atomic     g_rings[TRACE_MAX_THREADS];
+static _Atomic int            g_nrings;
+static volatile sig_atomic_t  g_dump_requested;
+static pthread_mutex_t        g_write_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+static _Thread_local TraceRing *t_ring;
+static _Thread_local int        t_no_ring;   /* registry was full */
+
+static const char *const kind_names[TRACE_KINDS] = {
+    "generate", "spawn", "wait", "capture", "learn", "lock words", "lock obs",
+};
+
+/* =========================
+* Internal helpers
+* ========================= */
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* This thread's ring, registered on first use; NULL if none is left. */
+static TraceRing *ring_get(void) {
+    if (t_ring || t_no_ring) return t_ring;
+    int idx = atomic_fetch_add(&g_nrings, 1);
+    TraceRing *r = idx < TRACE_MAX_THREADS ? (TraceRing *)calloc(1, sizeof(*r)) : NULL;
+    if (!r) {
+        t_no_ring = 1;
+        return NULL;
+    }
+    r->tid = idx + 1;
+    snprintf(r->name, sizeof(r->name), "thread %d", idx + 1);
+    atomic_store_explicit(&g_rings[idx], r, memory_order_release);
+    t_ring = r;
+    return r;
+}
+
+/* Returns the number of spans written. */
+static size_t write_ring(FILE *fp, const TraceRing *r, int pid, int *first) {
+    fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            *first ? "" : ",\n", pid, r->tid, r->name);
+    *first = 0;
+    uint64_t head = atomic_load_explicit(&((TraceRing *)r)->head, memory_order_acquire);
+    /* a live writer may be overwriting the oldest slots: leave them out */
+    uint64_t keep = TRACE_RING_EVENTS - TRACE_RING_EVENTS / 8;
+    uint64_t from = head > keep ? head - keep : 0;
+    size_t n = 0;
+    for (uint64_t i = from; i < head; ++i) {
+        const TraceEvent *e = &r->ev[i % TRACE_RING_EVENTS];
+        if (e->kind >= TRACE_KINDS) continue;
+        fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                kind_names[e->kind], pid, r->tid, (double)e->start_ns / 1e3, (double)e->dur_ns / 1e3);
+        n++;
+    }
+    return n;
+}
+
+/* =========================
+* Public API
+* ========================= */
+
+void trace_enable(const char *path) {
+    free(g_path);
+    g_path = path ? strdup(path) : NULL;
+    g_epoch_ns = now_ns();
+    atomic_store(&g_on, g_path != NULL);
+}
+
+int trace_enabled(void) {
+    return atomic_load_explicit(&g_on, memory_order_relaxed);
+}
+
+void trace_thread_name(const char *name) {
+    if (!trace_enabled() || !name) return;
+    TraceRing *r = ring_get();
+    if (r) snprintf(r->name, sizeof(r->name), "%s", name);
+}
+
+uint64_t trace_begin(void) {
+    return trace_enabled() ? now_ns() : 0;
+}
+
+void trace_end(TraceKind kind, uint64_t start) {
+    if (!start) return;
+    TraceRing *r = ring_get();
+    if (!r) return;
+    uint64_t end = now_ns();
+    uint64_t dur = end > start ? end - start : 0;
+    uint64_t h = atomic_load_explicit(&r->head, memory_order_relaxed);
+    TraceEvent *e = &r->ev[h % TRACE_RING_EVENTS];
+    e->start_ns = start - g_epoch_ns;
+    e->dur_ns = dur > UINT32_MAX ? UINT32_MAX : (uint32_t)dur;
+    e->kind = (uint16_t)kind;
+    atomic_store_explicit(&r->head, h + 1, memory_order_release);
+}
+
+void trace_lock(pthread_mutex_t *m, TraceKind kind) {
+    if (!trace_enabled()) {
+        pthread_mutex_lock(m);
+        return;
+    }
+    if (pthread_mutex_trylock(m) == 0) return;
+    uint64_t t0 = now_ns();
+    pthread_mutex_lock(m);
+    trace_end(kind, t0);
+}
+
+int trace_write(void) {
+    if (!trace_enabled()) return 0;
+    pthread_mutex_lock(&g_write_mtx);
+    FILE *fp = fopen(g_path, "w");
+    if (!fp) {
+        perror("fopen trace");
+        pthread_mutex_unlock(&g_write_mtx);
+        return -1;
+    }
+    int pid = (int)getpid(), first = 1;
+    size_t events = 0;
+    fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    int n = atomic_load(&g_nrings);
+    for (int i = 0; i < n && i < TRACE_MAX_THREADS; ++i) {
+        const TraceRing *r = atomic_load_explicit(&g_rings[i], memory_order_acquire);
+        if (!r) continue;
+        events += write_ring(fp, r, pid, &first);
+    }
+    fprintf(fp, "\n]}\n");
+    int rc = fclose(fp) == 0 ? 0 : -1;
+#if LOG_ACTIONS
+    fprintf(stdout, "[trace] wrote %zu span(s) from %d thread(s) -> %s\n", events, MIN(n, TRACE_MAX_THREADS), g_path);
+#endif
+    pthread_mutex_unlock(&g_write_mtx);
+    return rc;
+}
+
+void trace_free(void) {
+    int n = atomic_exchange(&g_nrings, 0);
+    for (int i = 0; i < n && i < TRACE_MAX_THREADS; ++i) {
+        free(atomic_exchange_explicit(&g_rings[i], NULL, memory_order_acq_rel));
+    }
+    t_ring = NULL;
+    t_no_ring = 0;
+    atomic_store(&g_on, 0);
+    free(g_path);
+    g_path = NULL;
+}
+
+void trace_signal_handler(int signum) {
+    (void)signum;
+    g_dump_requested = 1;
+}
+
+void trace_poll_dump(void) {
+    if (!g_dump_requested) return;
+    g_dump_requested = 0;
+    (void)trace_write();
+}
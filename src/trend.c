@@ -1,49 +1,172 @@
 // src/trend.c
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+#include <time.h>
 
 #include "config.h"
 #include "model.h"
 #include "trend.h"
 
+/* The calling thread's shard in each of the last few trackers it pushed
+ * to, keyed by tracker id (a re-initialized tracker gets a new one). */
+#define TREND_TL_SLOTS 4
+typedef struct {
+    unsigned long id;      /* 0 = unused */
+    int           shard;
+} ShardSlot;
+static _Thread_local ShardSlot tl_slots[TREND_TL_SLOTS];
+static _Thread_local int       tl_next_slot;
+static _Atomic unsigned long   g_tracker_ids;
+
+static const int k_ewma_halflives[TREND_EWMA_COUNT] = TREND_EWMA_HALFLIVES;
+static const int k_time_windows[TREND_TIME_WINDOW_COUNT] = TREND_TIME_WINDOWS_S;
+
+/* Trend threshold: ignore tiny changes to avoid flapping. */
+static const double TREND_EPS = 0.5;
+
 /* =========================
 * Internal helpers
 * ========================= */
 
-static double compute_average(const LearningTrendTracker *t) {
-    if (!t || t->count <= 0) return 0.0;
-    long sum = 0;
-    for (int i = 0; i < t->count; ++i) sum += t->lrnvals[i];
-    return (double)sum / (double)t->count;
+static long now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long)ts.tv_sec;
+}
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Per-sample decay for a half-life of `hl` samples: (1-a)^hl = 1/2 */
+static double ewma_alpha(int hl) {
+    return hl > 0 ? 1.0 - exp2(-1.0 / (double)hl) : 1.0;
+}
+
+static int recent_half(const LearningTrendTracker *t) {
+    int h = t->window_size / 2;
+    return h > 0 ? h : 1;
+}
+
+/* Merge all shards: totals over the window and over its recent/prior halves. */
+static void merge_shards(const LearningTrendTracker *t,
+                         long *recent_sum, long *recent_n,
+                         long *prior_sum, long *prior_n) {
+    long rs = 0, rn = 0, ps = 0, pn = 0;
+    long h = recent_half(t), w = t->window_size;
+    for (int s = 0; s < TREND_SHARDS; ++s) {
+        const TrendShard *sh = &t->shards[s];
+        long head = atomic_load_explicit(&sh->head, memory_order_acquire);
+        if (head <= 0) continue;
+        long c = head < w ? head : w;
+        long r = head < h ? head : h;
+        rs += atomic_load_explicit(&sh->recent_sum, memory_order_relaxed);
+        ps += atomic_load_explicit(&sh->prior_sum, memory_order_relaxed);
+        rn += r;
+        pn += c - r;
+    }
+    *recent_sum = rs; *recent_n = rn;
+    *prior_sum = ps;  *prior_n = pn;
+}
+
+/* Merge per-shard EWMAs, weighting each shard by how warmed up it is
+* (samples seen, capped at two half-lives). Returns total samples. */
+static long merge_ewma(const LearningTrendTracker *t, int e, double *out) {
+    double num = 0.0, den = 0.0;
+    long total = 0;
+    long cap = 2L * k_ewma_halflives[e];
+    for (int s = 0; s < TREND_SHARDS; ++s) {
+        const TrendShard *sh = &t->shards[s];
+        long head = atomic_load_explicit(&sh->head, memory_order_acquire);
+        if (head <= 0) continue;
+        double w = (double)(head < cap ? head : cap);
+        num += w * atomic_load_explicit(&sh->ewma[e], memory_order_relaxed);
+        den += w;
+        total += head;
+    }
+    *out = den > 0.0 ? num / den : 0.0;
+    return total;
+}
+
+/* Fast vs slow EWMA once the slow one is warm; until then the
+* recent-half vs prior-half comparison over the merged shards. */
+static int merged_trend(const LearningTrendTracker *t) {
+    double fast, slow, delta;
+    long total = merge_ewma(t, 1, &slow);
+    if (total >= k_ewma_halflives[1]) {
+        (void)merge_ewma(t, 0, &fast);
+        delta = fast - slow;
+    } else {
+        long rs, rn, ps, pn;
+        merge_shards(t, &rs, &rn, &ps, &pn);
+        if (rn <= 0 || pn <= 0) return 0; /* not enough data */
+        delta = (double)rs / (double)rn - (double)ps / (double)pn;
+    }
+
+    if (delta > TREND_EPS)  return +1;
+    if (delta < -TREND_EPS) return -1;
+    return 0;
 }
 
-/* Compute average over the last `k` samples (k <= t->count). */
-static double compute_recent_avg(const LearningTrendTracker *t, int k) {
-    if (!t || k <= 0 || t->count <= 0) return 0.0;
-    long sum = 0;
-    int used = 0;
-    for (int i = 0; i < k; ++i) {
-        int idx = t->index - 1 - i;
-        while (idx < 0) idx += t->window_size;
-        sum += t->lrnvals[idx];
-        used++;
+/* Shard of `t` owned by the calling thread, assigned round-robin from
+* t->next_shard on its first push to `t`. */
+static int writer_shard(LearningTrendTracker *t) {
+    for (int i = 0; i < TREND_TL_SLOTS; ++i) {
+        if (tl_slots[i].id == t->id) return tl_slots[i].shard;
     }
-    return (used > 0) ? (double)sum / (double)used : 0.0;
+    ShardSlot *slot = &tl_slots[tl_next_slot++ % TREND_TL_SLOTS];
+    slot->id = t->id;
+    slot->shard = atomic_fetch_add(&t->next_shard, 1) % TREND_SHARDS;
+    return slot->shard;
 }
 
-/* Compute average over the older samples (exclude the last `k_recent`). */
-static double compute_prior_avg(const LearningTrendTracker *t, int k_recent) {
-    if (!t) return 0.0;
-    int n = t->count;
-    int prior = n - k_recent;
-    if (prior <= 0) return 0.0;
-    long sum = 0;
-    for (int i = k_recent; i < n; ++i) {
-        int idx = t->index - 1 - i;
-        while (idx < 0) idx += t->window_size;
-        sum += t->lrnvals[idx];
+/* O(1) push into a single-writer shard, keeping the half-window sums current. */
+static void shard_push(const LearningTrendTracker *t, TrendShard *sh, int lrnval) {
+    long w = t->window_size, h = recent_half(t);
+    long n = atomic_load_explicit(&sh->head, memory_order_relaxed);
+    int slot = (int)(n % w);
+
+    long drecent = lrnval, dprior = 0;
+    if (n >= h) {
+        /* sample n-h crosses from the recent half into the prior half */
+        int moving = atomic_load_explicit(&sh->lrnvals[(n - h) % w], memory_order_relaxed);
+        drecent -= moving;
+        dprior  += moving;
     }
-    return (double)sum / (double)prior;
+    if (n >= w) {
+        /* sample n-w falls out of the window (it occupies our slot) */
+        dprior -= atomic_load_explicit(&sh->lrnvals[slot], memory_order_relaxed);
+    }
+
+    atomic_store_explicit(&sh->lrnvals[slot], lrnval, memory_order_relaxed);
+    atomic_fetch_add_explicit(&sh->recent_sum, drecent, memory_order_relaxed);
+    atomic_fetch_add_explicit(&sh->prior_sum, dprior, memory_order_relaxed);
+
+    /* EWMAs: the first sample seeds them, so they carry no zero bias. */
+    for (int e = 0; e < TREND_EWMA_COUNT; ++e) {
+        double v = (double)lrnval;
+        if (n > 0) {
+            double cur = atomic_load_explicit(&sh->ewma[e], memory_order_relaxed);
+            v = cur + t->ewma_alpha[e] * ((double)lrnval - cur);
+        }
+        atomic_store_explicit(&sh->ewma[e], v, memory_order_relaxed);
+    }
+
+    /* One-second bucket; a stale bucket (older second) is recycled. */
+    long sec = now_sec();
+    TrendBucket *b = &sh->buckets[sec % TREND_RATE_BUCKETS];
+    if (atomic_load_explicit(&b->sec, memory_order_relaxed) != sec) {
+        atomic_store_explicit(&b->n, 0, memory_order_relaxed);
+        atomic_store_explicit(&b->sum, 0, memory_order_relaxed);
+        atomic_store_explicit(&b->sec, sec, memory_order_release);
+    }
+    atomic_fetch_add_explicit(&b->n, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&b->sum, lrnval, memory_order_relaxed);
+
+    atomic_store_explicit(&sh->head, n + 1, memory_order_release);
 }
 
 /* =========================
@@ -53,72 +176,200 @@ static double compute_prior_avg(const LearningTrendTracker *t, int k_recent) {
 void init_trend_tracker(LearningTrendTracker *tracker) {
     if (!tracker) return;
     tracker->window_size = TREND_WINDOW_SIZE;
-    tracker->lrnvals = (int*)calloc((size_t)tracker->window_size, sizeof(int));
-    tracker->index = 0;
-    tracker->count = 0;
-    tracker->moving_average = 0.0;
+    tracker->start_s = now_s();
+    for (int s = 0; s < TREND_SHARDS; ++s) {
+        TrendShard *sh = &tracker->shards[s];
+        atomic_init(&sh->head, 0);
+        atomic_init(&sh->recent_sum, 0);
+        atomic_init(&sh->prior_sum, 0);
+        for (int i = 0; i < TREND_WINDOW_SIZE; ++i) atomic_init(&sh->lrnvals[i], 0);
+        for (int e = 0; e < TREND_EWMA_COUNT; ++e) atomic_init(&sh->ewma[e], 0.0);
+        for (int i = 0; i < TREND_RATE_BUCKETS; ++i) {
+            atomic_init(&sh->buckets[i].sec, -1);
+            atomic_init(&sh->buckets[i].n, 0);
+            atomic_init(&sh->buckets[i].sum, 0);
+        }
+        sh->since_check = 0;
+        sh->since_signal = 0;
+    }
+    for (int e = 0; e < TREND_EWMA_COUNT; ++e) {
+        tracker->ewma_alpha[e] = ewma_alpha(k_ewma_halflives[e]);
+    }
+    tracker->id = atomic_fetch_add(&g_tracker_ids, 1) + 1;
+    atomic_init(&tracker->next_shard, 0);
+    atomic_init(&tracker->moving_average, 0.0);
+    atomic_init(&tracker->last_trend, 0);
+    tracker->pending = 0;
+    tracker->shutdown = 0;
     pthread_mutex_init(&tracker->mutex, NULL);
+    pthread_cond_init(&tracker->cond, NULL);
 }
 
 void destroy_trend_tracker(LearningTrendTracker *tracker) {
     if (!tracker) return;
-    if (tracker->lrnvals) {
-        free(tracker->lrnvals);
-        tracker->lrnvals = NULL;
-    }
     tracker->window_size = 0;
-    tracker->index = 0;
-    tracker->count = 0;
-    tracker->moving_average = 0.0;
+    atomic_store(&tracker->moving_average, 0.0);
+    pthread_cond_destroy(&tracker->cond);
     pthread_mutex_destroy(&tracker->mutex);
 }
 
 void update_trend_tracker(LearningTrendTracker *tracker, int lrnval) {
-    if (!tracker || !tracker->lrnvals) return;
+    if (!tracker || tracker->window_size <= 0) return;
 
-    pthread_mutex_lock(&tracker->mutex);
+    TrendShard *sh = &tracker->shards[writer_shard(tracker)];
+    shard_push(tracker, sh, lrnval);
 
-    tracker->lrnvals[tracker->index] = lrnval;
-    tracker->index = (tracker->index + 1) % tracker->window_size;
-    if (tracker->count < tracker->window_size) tracker->count++;
+    /* Between checkpoints a push touches only the caller's shard. */
+    if (++sh->since_check < TUNER_SIGNAL_EVERY) return;
+    sh->since_check = 0;
 
-    tracker->moving_average = compute_average(tracker);
+    long rs, rn, ps, pn;
+    merge_shards(tracker, &rs, &rn, &ps, &pn);
+    double ma = (rn + pn) > 0 ? (double)(rs + ps) / (double)(rn + pn) : 0.0;
+    atomic_store_explicit(&tracker->moving_average, ma, memory_order_relaxed);
+
+    /* Wake the tuner on a flip, or once this writer's share of the
+     * TUNER_SIGNAL_EVERY-sample pace is due (writers * K own samples).
+     * Only this (rare) path touches the mutex. */
+    int writers = atomic_load_explicit(&tracker->next_shard, memory_order_relaxed);
+    if (writers < 1) writers = 1;
+    if (writers > TREND_SHARDS) writers = TREND_SHARDS;
+    sh->since_signal += TUNER_SIGNAL_EVERY;
+    int trend = merged_trend(tracker);
+    int flipped = trend != atomic_load_explicit(&tracker->last_trend, memory_order_relaxed) &&
+                  trend != atomic_exchange(&tracker->last_trend, trend);
+    if (flipped || sh->since_signal >= writers * TUNER_SIGNAL_EVERY) {
+        sh->since_signal = 0;
+        pthread_mutex_lock(&tracker->mutex);
+        tracker->pending = 1;
+        pthread_cond_signal(&tracker->cond);
+        pthread_mutex_unlock(&tracker->mutex);
+    }
+}
 
+int wait_trend_event(LearningTrendTracker *tracker) {
+    if (!tracker) return -1;
+    pthread_mutex_lock(&tracker->mutex);
+    while (!tracker->pending && !tracker->shutdown) {
+        pthread_cond_wait(&tracker->cond, &tracker->mutex);
+    }
+    int rc = tracker->shutdown ? -1 : 0;
+    tracker->pending = 0;
+    pthread_mutex_unlock(&tracker->mutex);
+    return rc;
+}
+
+void shutdown_trend_tracker(LearningTrendTracker *tracker) {
+    if (!tracker) return;
+    pthread_mutex_lock(&tracker->mutex);
+    tracker->shutdown = 1;
+    pthread_cond_broadcast(&tracker->cond);
     pthread_mutex_unlock(&tracker->mutex);
 }
 
 double get_moving_average(const LearningTrendTracker *tracker) {
     if (!tracker) return 0.0;
-    pthread_mutex_lock((pthread_mutex_t*)&tracker->mutex);
-    double ma = tracker->moving_average;
-    pthread_mutex_unlock((pthread_mutex_t*)&tracker->mutex);
-    return ma;
+    return atomic_load_explicit(&((LearningTrendTracker *)tracker)->moving_average,
+                                memory_order_relaxed);
 }
 
-int analyze_learning_trend(const LearningTrendTracker *tracker) {
-    if (!tracker) return 0;
+void get_trend_snapshot(const LearningTrendTracker *tracker, TrendSnapshot *out) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    if (!tracker || tracker->window_size <= 0) return;
 
-    pthread_mutex_lock((pthread_mutex_t*)&tracker->mutex);
+    for (int e = 0; e < TREND_EWMA_COUNT; ++e) {
+        out->samples = merge_ewma(tracker, e, &out->ewma[e]);
+    }
 
-    int n = tracker->count;
-    if (n < 2) {
-        pthread_mutex_unlock((pthread_mutex_t*)&tracker->mutex);
-        return 0; /* not enough data */
+    /* Time windows end at the last completed second plus the current one. */
+    long now = now_sec();
+    long n[TREND_TIME_WINDOW_COUNT] = {0}, sum[TREND_TIME_WINDOW_COUNT] = {0};
+    for (int s = 0; s < TREND_SHARDS; ++s) {
+        const TrendShard *sh = &tracker->shards[s];
+        for (int i = 0; i < TREND_RATE_BUCKETS; ++i) {
+            const TrendBucket *b = &sh->buckets[i];
+            long age = now - atomic_load_explicit(&b->sec, memory_order_acquire);
+            if (age < 0 || age >= TREND_RATE_BUCKETS) continue;
+            long bn = atomic_load_explicit(&b->n, memory_order_relaxed);
+            long bs = atomic_load_explicit(&b->sum, memory_order_relaxed);
+            for (int w = 0; w < TREND_TIME_WINDOW_COUNT; ++w) {
+                if (age < k_time_windows[w]) { n[w] += bn; sum[w] += bs; }
+            }
+        }
+    }
+    /* A window longer than the tracker's uptime only holds the uptime. */
+    double up = now_s() - tracker->start_s;
+    for (int w = 0; w < TREND_TIME_WINDOW_COUNT; ++w) {
+        double span = up < (double)k_time_windows[w] ? up : (double)k_time_windows[w];
+        out->window_s[w]    = k_time_windows[w];
+        out->window_mean[w] = n[w] > 0 ? (double)sum[w] / (double)n[w] : 0.0;
+        out->window_rate[w] = span > 0.0 ? (double)n[w] / span : 0.0;
     }
+}
 
-    /* Compare the most recent half-window vs the prior half-window. */
-    int k_recent = n / 2;
-    if (k_recent <= 0) k_recent = 1;
+void get_trend_state(const LearningTrendTracker *tracker, TrendState *out) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    if (!tracker || tracker->window_size <= 0) return;
 
-    double recent = compute_recent_avg(tracker, k_recent);
-    double prior  = compute_prior_avg(tracker, k_recent);
-    double delta  = recent - prior;
+    for (int e = 0; e < TREND_EWMA_COUNT; ++e) {
+        out->samples = merge_ewma(tracker, e, &out->ewma[e]);
+    }
 
-    pthread_mutex_unlock((pthread_mutex_t*)&tracker->mutex);
+    /* Round-robin over the shards, newest sample first, then reverse. */
+    long w = tracker->window_size, head[TREND_SHARDS];
+    for (int s = 0; s < TREND_SHARDS; ++s) {
+        head[s] = atomic_load_explicit(&tracker->shards[s].head, memory_order_acquire);
+    }
+    int n = 0;
+    for (long age = 0; age < w && n < TREND_WINDOW_SIZE; ++age) {
+        for (int s = 0; s < TREND_SHARDS && n < TREND_WINDOW_SIZE; ++s) {
+            if (age >= head[s] || age >= w) continue;
+            out->window[n++] = atomic_load_explicit(
+                &tracker->shards[s].lrnvals[(head[s] - 1 - age) % w], memory_order_relaxed);
+        }
+    }
+    for (int i = 0; i < n / 2; ++i) {
+        int t = out->window[i];
+        out->window[i] = out->window[n - 1 - i];
+        out->window[n - 1 - i] = t;
+    }
+    out->nwindow = n;
+}
 
-    /* Simple threshold to avoid flapping on tiny changes. */
-    const double EPS = 0.5; /* tweak if you want a more/less sensitive trend */
-    if (delta > EPS)  return +1;
-    if (delta < -EPS) return -1;
-    return 0;
+void restore_trend_state(LearningTrendTracker *tracker, const TrendState *in) {
+    if (!tracker || !in || tracker->window_size <= 0 || in->samples <= 0) return;
+    TrendShard *sh = &tracker->shards[0];
+    long w = tracker->window_size, h = recent_half(tracker);
+    int n = in->nwindow < 0 ? 0 : in->nwindow > w ? (int)w : in->nwindow;
+    long head = in->samples < n ? n : in->samples;
+    if (n < w && head > n) head = n;   /* short window: keep the sums consistent */
+
+    /* The window's newest sample ends up in slot (head - 1) % w. */
+    long recent = 0, prior = 0;
+    for (int j = 0; j < n; ++j) {
+        long age = n - 1 - j;
+        int v = in->window[j];
+        atomic_store_explicit(&sh->lrnvals[(head - 1 - age) % w], v, memory_order_relaxed);
+        if (age < h) recent += v;
+        else prior += v;
+    }
+    atomic_store_explicit(&sh->recent_sum, recent, memory_order_relaxed);
+    atomic_store_explicit(&sh->prior_sum, prior, memory_order_relaxed);
+    for (int e = 0; e < TREND_EWMA_COUNT; ++e) {
+        atomic_store_explicit(&sh->ewma[e], in->ewma[e], memory_order_relaxed);
+    }
+    atomic_store_explicit(&sh->head, head, memory_order_release);
+
+    long rs, rn, ps, pn;
+    merge_shards(tracker, &rs, &rn, &ps, &pn);
+    double ma = (rn + pn) > 0 ? (double)(rs + ps) / (double)(rn + pn) : 0.0;
+    atomic_store_explicit(&tracker->moving_average, ma, memory_order_relaxed);
+    atomic_store(&tracker->last_trend, merged_trend(tracker));
+}
+
+int analyze_learning_trend(const LearningTrendTracker *tracker) {
+    if (!tracker || tracker->window_size <= 0) return 0;
+    return merged_trend(tracker);
 }
@@ -0,0 +1,57 @@
+// src/trycount.c
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include "config.h"
+#include "memacct.h"
+#include "trycount.h"
+
+/* =========================
+* Internal helpers
+* ========================= */
+
+static size_t slot_of(const TryCount *t, int i, int pi, int k, int pk) {
+    uint64_t x = ((uint64_t)(uint32_t)i << 32 | (uint32_t)k) ^ ((uint64_t)(uint32_t)pi << 56 | (uint64_t)(uint32_t)pk << 48);
+    x ^= x >> 33; x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33; x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return (size_t)x & t->mask;
+}
+
+/* =========================
+* Public API
+* ========================= */
+
+int trycount_init(TryCount *t, size_t slots_hint) {
+    if (!t) return -1;
+    size_t n = 1;
+    while (n < (slots_hint ? slots_hint : (size_t)EXPLORE_PAIR_SLOTS)) n <<= 1;
+    t->slot = (unsigned short *)calloc(n, sizeof(*t->slot));
+    t->mask = t->slot ? n - 1 : 0;
+    memacct_add(MEM_TABLES, (long)trycount_bytes(t));
+    return t->slot ? 0 : -1;
+}
+
+void trycount_free(TryCount *t) {
+    if (!t) return;
+    memacct_add(MEM_TABLES, -(long)trycount_bytes(t));
+    free(t->slot);
+    t->slot = NULL;
+    t->mask = 0;
+}
+
+void trycount_note(TryCount *t, int i, int pi, int k, int pk) {
+    if (!t || !t->slot) return;
+    unsigned short *c = &t->slot[slot_of(t, i, pi, k, pk)];
+    if (*c < USHRT_MAX) (*c)++;
+}
+
+unsigned trycount_get(const TryCount *t, int i, int pi, int k, int pk) {
+    if (!t || !t->slot) return 0;
+    return t->slot[slot_of(t, i, pi, k, pk)];
+}
+
+size_t trycount_bytes(const TryCount *t) {
+    return (t && t->slot) ? (t->mask + 1) * sizeof(*t->slot) : 0;
+}